@@ -0,0 +1,228 @@
+#include <malloc.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ash/Module.hpp>
+#include <ash/SpscQueue.hpp>
+
+// ash::Future against std::future, end to end. Built twice, once with
+// USE_STD_FUTURE, so that ash::Module runs on the same futures as the rest
+// of the benchmark. Each run prints CSV rows
+//     variant,metric,producers,value,unit
+// so that the output of both binaries can be concatenated and compared.
+
+namespace {
+#ifdef USE_STD_FUTURE
+constexpr const char* VARIANT = "std";
+using Promise = std::promise<int>;
+using Future = std::future<int>;
+
+Future getFuture(Promise& promise)
+{
+    return promise.get_future();
+}
+
+void setValue(Promise& promise, int value)
+{
+    promise.set_value(value);
+}
+#else
+constexpr const char* VARIANT = "ash";
+using Promise = ash::Promise<int>;
+using Future = ash::Future<int>;
+
+Future getFuture(Promise& promise)
+{
+    return promise.getFuture();
+}
+
+void setValue(Promise& promise, int value)
+{
+    promise.setValue(value);
+}
+#endif
+
+constexpr int CREATIONS = 1'000'000;
+constexpr int HANDOFFS = 100'000;
+constexpr int OUTSTANDING = 100'000;
+constexpr int REQUESTS = 200'000;
+
+// Bytes currently allocated through the global operator new
+std::atomic<int64_t> liveBytes(0);
+
+void report(const std::string& metric, int producers, double value, const char* unit)
+{
+    std::cout << VARIANT << ',' << metric << ',' << producers << ',' << value << ',' << unit << std::endl;
+}
+
+double nanosecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Promise and future created, fulfilled and read on one thread
+void measureCreation()
+{
+    int64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < CREATIONS; ++i)
+    {
+        Promise promise;
+        auto future = getFuture(promise);
+        setValue(promise, i);
+        sum += future.get();
+    }
+    report("create_set_get", 1, nanosecondsSince(start) / CREATIONS, "ns");
+    if (sum != static_cast<int64_t>(CREATIONS) * (CREATIONS - 1) / 2)
+    {
+        std::cerr << "Wrong sum " << sum << std::endl;
+    }
+}
+
+// Time from setValue on one thread to get() returning on another, which is
+// blocked in it most of the time
+void measureHandoff()
+{
+    std::vector<Promise> promises(HANDOFFS);
+    std::vector<Future> futures;
+    futures.reserve(HANDOFFS);
+    for (auto& promise : promises)
+    {
+        futures.push_back(getFuture(promise));
+    }
+    std::vector<std::chrono::steady_clock::time_point> setTimes(HANDOFFS);
+    ash::SpscQueue<int> indices(1024);
+    std::thread responder([&]()
+    {
+        for (int n = 0; n < HANDOFFS; ++n)
+        {
+            auto i = *indices.pop();
+            setTimes[i] = std::chrono::steady_clock::now();
+            setValue(promises[i], i);
+        }
+    });
+    std::vector<double> latencyNs(HANDOFFS);
+    for (int i = 0; i < HANDOFFS; ++i)
+    {
+        indices.push(i);
+        futures[i].get();
+        latencyNs[i] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - setTimes[i]).count();
+    }
+    responder.join();
+    std::sort(latencyNs.begin(), latencyNs.end());
+    report("set_get_latency_p50", 1, latencyNs[HANDOFFS / 2], "ns");
+    report("set_get_latency_p99", 1, latencyNs[HANDOFFS * 99 / 100], "ns");
+    report("set_get_latency_max", 1, latencyNs.back(), "ns");
+}
+
+// Heap held by a request posted to ash::Module and its future until the
+// response comes, which is never here: the Module drops them all
+void measureMemory()
+{
+    std::vector<int> xs(OUTSTANDING, 1);
+    ash::Module module(1, std::chrono::hours(1), std::chrono::hours(1));
+    auto before = liveBytes.load();
+    auto responses = module.postRequests(xs);
+    auto after = liveBytes.load();
+    report("bytes_per_outstanding_request", 1, static_cast<double>(after - before) / OUTSTANDING, "bytes");
+}
+
+// Requests answered per second by ash::Module with as many workers as
+// cores, each producer posting its share one by one and then waiting for
+// all the responses
+void measureThroughput(int producers)
+{
+    auto workers = std::max(1u, std::thread::hardware_concurrency());
+    ash::Module module(workers, std::chrono::milliseconds(0), std::chrono::milliseconds(0));
+    std::vector<std::thread> threads;
+    std::vector<int64_t> sums(producers, 0);
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&module, &sums, p, producers]()
+        {
+            std::vector<ash::Module::DelayedResponse> responses;
+            responses.reserve(REQUESTS / producers + 1);
+            for (int i = p; i < REQUESTS; i += producers)
+            {
+                responses.push_back(module.postRequest(i));
+            }
+            for (auto& response : responses)
+            {
+                sums[p] += response.get();
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    report("module_throughput", producers, REQUESTS / (nanosecondsSince(start) * 1e-9), "requests_per_s");
+}
+}
+
+void* operator new(std::size_t size)
+{
+    if (auto* p = std::malloc(size ? size : 1))
+    {
+        liveBytes.fetch_add(static_cast<int64_t>(malloc_usable_size(p)), std::memory_order_relaxed);
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    auto align = static_cast<std::size_t>(alignment);
+    if (auto* p = std::aligned_alloc(align, (size + align - 1) / align * align))
+    {
+        liveBytes.fetch_add(static_cast<int64_t>(malloc_usable_size(p)), std::memory_order_relaxed);
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    if (p)
+    {
+        liveBytes.fetch_sub(static_cast<int64_t>(malloc_usable_size(p)), std::memory_order_relaxed);
+        std::free(p);
+    }
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+    operator delete(p);
+}
+
+int main()
+{
+    std::clog.setstate(std::ios::failbit);  // Module logs its destruction
+    std::cout << "variant,metric,producers,value,unit" << std::endl;
+    measureCreation();
+    measureHandoff();
+    measureMemory();
+    for (int producers : {1, 2, 4, 8})
+    {
+        measureThroughput(producers);
+    }
+}
@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <vector>
+#include <ash/Module.hpp>
+
+#ifdef USE_STD_FUTURE
+#error "module_benchmark measures ash::Future continuations"
+#endif
+
+// Throughput and latency of ash::Module with 1 to 32 workers. Requests are
+// due right away and each response runs a continuation that keeps the
+// completing worker busy for a few microseconds, so the work done per
+// response is spread by stealing rather than by the routing of requests.
+
+namespace {
+constexpr size_t REQUESTS = 200'000;
+constexpr size_t BATCH = 1000;
+constexpr auto WORK = std::chrono::microseconds(2);
+
+void busyWait(std::chrono::steady_clock::duration duration)
+{
+    auto end = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < end)
+    {
+    }
+}
+
+double percentile(const std::vector<int64_t>& sorted, double p)
+{
+    auto index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+    return static_cast<double>(sorted[index]) * 1e-3;
+}
+
+void run(size_t workers)
+{
+    std::vector<int64_t> latencyNs(REQUESTS);
+    std::vector<ash::Future<int>> done;
+    done.reserve(REQUESTS);
+    std::vector<int> xs(BATCH);
+    std::iota(xs.begin(), xs.end(), 0);
+    std::chrono::duration<double> elapsed;
+    {
+        ash::Module module(workers, std::chrono::milliseconds(0), std::chrono::milliseconds(0));
+        auto start = std::chrono::steady_clock::now();
+        for (size_t first = 0; first < REQUESTS; first += BATCH)
+        {
+            auto posted = std::chrono::steady_clock::now();
+            auto responses = module.postRequests(xs);
+            for (size_t i = 0; i < responses.size(); ++i)
+            {
+                auto* latency = &latencyNs[first + i];
+                done.push_back(responses[i].then([latency, posted](ash::Future<int> response)
+                {
+                    auto value = response.get();
+                    busyWait(WORK);
+                    *latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - posted).count();
+                    return value;
+                }));
+            }
+        }
+        ash::whenAll(std::move(done)).wait();
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+    std::sort(latencyNs.begin(), latencyNs.end());
+    std::cout << workers << ',' << REQUESTS / elapsed.count() << ',' << percentile(latencyNs, 0.5) << ','
+              << percentile(latencyNs, 0.99) << ',' << percentile(latencyNs, 0.999) << ','
+              << static_cast<double>(latencyNs.back()) * 1e-3 << std::endl;
+}
+}
+
+int main()
+{
+    std::cout << "workers,requests_per_s,p50_us,p99_us,p999_us,max_us" << std::endl;
+    for (size_t workers : {1, 2, 4, 8, 16, 32})
+    {
+        run(workers);
+    }
+}
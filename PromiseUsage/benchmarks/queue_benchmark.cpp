@@ -0,0 +1,80 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ash/MpmcQueue.hpp>
+#include <ash/SpscQueue.hpp>
+#include <ash/SyncCircularBuffer.hpp>
+
+// Hand-off throughput of the mutex-based SyncCircularBuffer against the
+// lock-free queues, with the same number of producers and consumers pushing
+// and popping through the blocking interface.
+
+namespace {
+constexpr size_t BUFFER_SIZE = 1024;
+constexpr uint64_t ITEMS = 4'000'000;
+
+template<class Queue>
+double run(int producers, int consumers)
+{
+    Queue queue(BUFFER_SIZE);
+    std::vector<std::thread> threads;
+    std::vector<uint64_t> sums(consumers, 0);
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&queue, p, producers]()
+        {
+            for (uint64_t i = p; i < ITEMS; i += producers)
+            {
+                queue.push(i);
+            }
+        });
+    }
+    for (int c = 0; c < consumers; ++c)
+    {
+        threads.emplace_back([&queue, &sums, c, consumers]()
+        {
+            uint64_t count = ITEMS / consumers + (static_cast<uint64_t>(c) < ITEMS % consumers ? 1 : 0);
+            for (uint64_t i = 0; i < count; ++i)
+            {
+                sums[c] += *queue.pop();
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    uint64_t sum = 0;
+    for (auto partial : sums)
+    {
+        sum += partial;
+    }
+    if (sum != ITEMS * (ITEMS - 1) / 2)
+    {
+        std::cerr << "lost or duplicated items" << std::endl;
+    }
+    return ITEMS / elapsed.count() * 1e-6;
+}
+
+void report(const std::string& name, int producers, int consumers, double mops)
+{
+    std::cout << name << ',' << producers << ',' << consumers << ',' << mops << std::endl;
+}
+}
+
+int main()
+{
+    std::cout << "queue,producers,consumers,mops_per_s" << std::endl;
+    report("SyncCircularBuffer", 1, 1, run<ash::SyncCircularBuffer<uint64_t>>(1, 1));
+    report("SpscQueue", 1, 1, run<ash::SpscQueue<uint64_t>>(1, 1));
+    for (int threads : {1, 2, 4, 8})
+    {
+        report("SyncCircularBuffer", threads, threads, run<ash::SyncCircularBuffer<uint64_t>>(threads, threads));
+        report("MpmcQueue", threads, threads, run<ash::MpmcQueue<uint64_t>>(threads, threads));
+    }
+}
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ash/Async.hpp>
+#include <ash/ThreadPool.hpp>
+
+// CPU-bound fan-out of fib() over raw threads and over ash::ThreadPool, and
+// how long short latency-critical callbacks wait for a thread while the pool
+// is saturated with long batch callbacks. Prints CSV rows
+//     scenario,threads,metric,value
+// to stdout.
+
+namespace {
+constexpr int TASKS = 64;
+constexpr uint64_t FIB_N = 27;
+constexpr int PROBES = 200;
+
+uint64_t fib(uint64_t n)
+{
+    if (n <= 1)
+    {
+        return 1;
+    }
+    return fib(n - 1) + fib(n - 2);
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void report(const std::string& scenario, std::size_t threads, const std::string& metric, double value)
+{
+    std::cout << scenario << ',' << threads << ',' << metric << ',' << value << std::endl;
+}
+
+void fanOutOverThreads()
+{
+    std::vector<uint64_t> results(TASKS);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < TASKS; ++i)
+    {
+        threads.emplace_back([&results, i]() { results[i] = fib(FIB_N); });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    report("fan_out_std_thread", TASKS, "seconds", secondsSince(start));
+}
+
+void fanOutOverPool(ash::ThreadPool& pool)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ash::Future<uint64_t>> results;
+    for (int i = 0; i < TASKS; ++i)
+    {
+        results.push_back(ash::async(pool.lane(ash::Priority::BATCH), []() { return fib(FIB_N); }));
+    }
+    ash::whenAll(std::move(results)).wait();
+    report("fan_out_pool", pool.size(), "seconds", secondsSince(start));
+}
+
+// Same, but posted by a callback running on a worker: the callbacks go to
+// that worker's deque and the other workers steal them
+void fanOutFromWorker(ash::ThreadPool& pool)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto done = ash::async(pool, [&pool]()
+    {
+        std::vector<ash::Future<uint64_t>> results;
+        for (int i = 0; i < TASKS; ++i)
+        {
+            results.push_back(ash::async(pool.lane(ash::Priority::BATCH), []() { return fib(FIB_N); }));
+        }
+        return ash::whenAll(std::move(results));
+    });
+    done.get().wait();
+    report("fan_out_pool_from_worker", pool.size(), "seconds", secondsSince(start));
+}
+
+// Short probes posted while the pool has a backlog of batch callbacks;
+// reports how long the probes waited before they started running
+void probeLatency(ash::ThreadPool& pool, ash::Priority probePriority, const std::string& scenario)
+{
+    std::vector<ash::Future<uint64_t>> backlog;
+    for (std::size_t i = 0; i < PROBES * pool.size(); ++i)
+    {
+        backlog.push_back(ash::async(pool.lane(ash::Priority::BATCH), []() { return fib(FIB_N); }));
+    }
+    std::vector<ash::Future<double>> waits;
+    for (int i = 0; i < PROBES; ++i)
+    {
+        auto posted = std::chrono::steady_clock::now();
+        waits.push_back(ash::async(pool.lane(probePriority), [posted]() { return secondsSince(posted) * 1e6; }));
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    std::vector<double> waitUs;
+    for (auto& wait : waits)
+    {
+        waitUs.push_back(wait.get());
+    }
+    ash::whenAll(std::move(backlog)).wait();
+    std::sort(waitUs.begin(), waitUs.end());
+    report(scenario, pool.size(), "wait_p50_us", waitUs[waitUs.size() / 2]);
+    report(scenario, pool.size(), "wait_p99_us", waitUs[waitUs.size() * 99 / 100]);
+}
+}
+
+int main()
+{
+    std::cout << "scenario,threads,metric,value" << std::endl;
+    fanOutOverThreads();
+    ash::ThreadPool pool;
+    fanOutOverPool(pool);
+    fanOutFromWorker(pool);
+    probeLatency(pool, ash::Priority::BATCH, "probe_batch_lane");
+    probeLatency(pool, ash::Priority::LATENCY_CRITICAL, "probe_latency_critical_lane");
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <type_traits>
+
+#include "Executor.hpp"
+#include "Future.hpp"
+
+namespace ash {
+// Runs fn() on the executor, e.g. a ThreadPool lane; the future gets its
+// result or what it throws.
+template<class F>
+Future<std::invoke_result_t<F>> async(Executor& executor, F&& fn);
+}
+
+#include "Async.ipp"
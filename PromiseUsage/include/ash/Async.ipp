@@ -0,0 +1,30 @@
+#pragma once
+
+#include <exception>
+#include <functional>
+#include <utility>
+
+#include "Promise.hpp"
+
+namespace ash {
+template<class F>
+Future<std::invoke_result_t<F>> async(Executor& executor, F&& fn)
+{
+    using R = std::invoke_result_t<F>;
+    static_assert(!std::is_void_v<R>, "Future<void> is not supported: fn must return a value");
+    Promise<R> promise;
+    auto result = promise.getFuture();
+    executor.execute([promise = std::move(promise), fn = std::forward<F>(fn)]() mutable
+    {
+        try
+        {
+            promise.setValue(std::invoke(fn));
+        }
+        catch (...)
+        {
+            promise.setException(std::current_exception());
+        }
+    });
+    return result;
+}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+
+#include "EventCount.hpp"
+
+namespace ash::impl {
+inline constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+std::size_t roundUpToPowerOfTwo(std::size_t size);
+
+// Blocking interface shared by the lock-free queues, with the same methods as
+// SyncCircularBuffer. Derived only implements the non-blocking operations:
+//     template<class U> bool doTryPush(U&& value);   // must not move from value on failure
+//     std::optional<T> doTryPop();
+// Blocked threads spin for a while, never past their timeout, and then
+// sleep on an EventCount, so producers and consumers only pay for a
+// notification when the other side actually found the queue full or empty.
+template<class Derived, class T>
+class BlockingQueue
+{
+public:
+    template<class U>
+    bool push(U&& value, std::chrono::milliseconds timeoutMs);
+
+    template<class U>
+    bool push(U&& value);
+
+    template<class U>
+    bool tryPush(U&& value);
+
+    std::optional<T> pop(std::chrono::milliseconds timeoutMs);
+    std::optional<T> pop();
+    std::optional<T> tryPop();
+
+    template<class Collection>
+    void popAll(Collection& values);
+
+protected:
+    BlockingQueue() = default;
+
+private:
+    static std::chrono::steady_clock::time_point deadlineAfter(std::chrono::milliseconds timeoutMs);
+    Derived& derived();
+
+    static constexpr auto MAX_WAIT_MS = std::chrono::milliseconds::max();
+    static constexpr int SPIN_COUNT = 128;
+    EventCount _notEmpty;
+    EventCount _notFull;
+};
+}
+
+#include "BlockingQueue.ipp"
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <thread>
+#include <type_traits>
+
+namespace ash::impl {
+inline std::size_t roundUpToPowerOfTwo(std::size_t size)
+{
+    std::size_t capacity = 1;
+    while (capacity < size)
+    {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+template<class Derived, class T>
+template<class U>
+bool BlockingQueue<Derived, T>::push(U&& value, std::chrono::milliseconds timeoutMs)
+{
+    static_assert(std::is_constructible_v<T, U&&>, "Can't construct: incompatible types or non-copyable class");
+    auto deadline = deadlineAfter(timeoutMs);
+    for (int spin = 0; spin < SPIN_COUNT; ++spin)
+    {
+        if (derived().doTryPush(std::forward<U>(value)))
+        {
+            _notEmpty.notifyAll();
+            return true;
+        }
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            break;
+        }
+        std::this_thread::yield();
+    }
+    for (;;)
+    {
+        auto key = _notFull.prepareWait();
+        if (derived().doTryPush(std::forward<U>(value)))
+        {
+            _notFull.cancelWait();
+            _notEmpty.notifyAll();
+            return true;
+        }
+        if (!_notFull.waitUntil(key, deadline))
+        {
+            return tryPush(std::forward<U>(value));
+        }
+    }
+}
+
+template<class Derived, class T>
+template<class U>
+bool BlockingQueue<Derived, T>::push(U&& value)
+{
+    return push(std::forward<U>(value), MAX_WAIT_MS);
+}
+
+template<class Derived, class T>
+template<class U>
+bool BlockingQueue<Derived, T>::tryPush(U&& value)
+{
+    static_assert(std::is_constructible_v<T, U&&>, "Can't construct: incompatible types or non-copyable class");
+    if (derived().doTryPush(std::forward<U>(value)))
+    {
+        _notEmpty.notifyAll();
+        return true;
+    }
+    return false;
+}
+
+template<class Derived, class T>
+std::optional<T> BlockingQueue<Derived, T>::pop(std::chrono::milliseconds timeoutMs)
+{
+    auto deadline = deadlineAfter(timeoutMs);
+    for (int spin = 0; spin < SPIN_COUNT; ++spin)
+    {
+        if (auto value = derived().doTryPop())
+        {
+            _notFull.notifyAll();
+            return value;
+        }
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            break;
+        }
+        std::this_thread::yield();
+    }
+    for (;;)
+    {
+        auto key = _notEmpty.prepareWait();
+        if (auto value = derived().doTryPop())
+        {
+            _notEmpty.cancelWait();
+            _notFull.notifyAll();
+            return value;
+        }
+        if (!_notEmpty.waitUntil(key, deadline))
+        {
+            return tryPop();
+        }
+    }
+}
+
+template<class Derived, class T>
+std::optional<T> BlockingQueue<Derived, T>::pop()
+{
+    return pop(MAX_WAIT_MS);
+}
+
+template<class Derived, class T>
+std::optional<T> BlockingQueue<Derived, T>::tryPop()
+{
+    auto value = derived().doTryPop();
+    if (value)
+    {
+        _notFull.notifyAll();
+    }
+    return value;
+}
+
+template<class Derived, class T>
+template<class Collection>
+void BlockingQueue<Derived, T>::popAll(Collection& values)
+{
+    bool popped = false;
+    while (auto value = derived().doTryPop())
+    {
+        values.push_back(std::move(*value));
+        popped = true;
+    }
+    if (popped)
+    {
+        _notFull.notifyAll();
+    }
+}
+
+template<class Derived, class T>
+std::chrono::steady_clock::time_point BlockingQueue<Derived, T>::deadlineAfter(std::chrono::milliseconds timeoutMs)
+{
+    return timeoutMs == MAX_WAIT_MS ?
+               std::chrono::steady_clock::time_point::max() :
+               std::chrono::steady_clock::now() + timeoutMs;
+}
+
+template<class Derived, class T>
+Derived& BlockingQueue<Derived, T>::derived()
+{
+    return static_cast<Derived&>(*this);
+}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+
+namespace ash {
+// Move-only void() function, so callbacks can own promises and futures.
+class Callback
+{
+public:
+    Callback() = default;
+
+    template<class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Callback>>>
+    Callback(F&& fn);
+
+    Callback(Callback&& other) noexcept = default;
+    Callback& operator=(Callback&& other) noexcept = default;
+    explicit operator bool() const;
+    void operator()();
+
+private:
+    struct Base
+    {
+        virtual ~Base() = default;
+        virtual void call() = 0;
+    };
+
+    template<class F>
+    struct Impl : Base
+    {
+        explicit Impl(F&& fn);
+        void call() override;
+
+        F fn;
+    };
+
+    std::unique_ptr<Base> _impl;
+};
+}
+
+#include "Callback.ipp"
@@ -0,0 +1,27 @@
+#pragma once
+
+namespace ash {
+template<class F, class>
+Callback::Callback(F&& fn) : _impl(std::make_unique<Impl<std::decay_t<F>>>(std::forward<F>(fn)))
+{}
+
+inline Callback::operator bool() const
+{
+    return static_cast<bool>(_impl);
+}
+
+inline void Callback::operator()()
+{
+    _impl->call();
+}
+
+template<class F>
+Callback::Impl<F>::Impl(F&& fn) : fn(std::move(fn))
+{}
+
+template<class F>
+void Callback::Impl<F>::call()
+{
+    fn();
+}
+}
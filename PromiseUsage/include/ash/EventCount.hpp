@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace ash::impl {
+// Lets threads block until some condition, checked outside of any lock,
+// becomes true. Notifying is a single atomic load while nobody is waiting;
+// the mutex and condition variable are only touched by threads that have
+// to sleep and by the notifications that wake them.
+//
+// Waiting protocol:
+//     auto key = eventCount.prepareWait();
+//     if (condition()) { eventCount.cancelWait(); }
+//     else { eventCount.waitUntil(key, deadline); }
+// and whoever makes the condition true calls notifyAll() afterwards.
+class EventCount
+{
+public:
+    EventCount();
+    EventCount(const EventCount& other) = delete;
+    EventCount& operator=(const EventCount& other) = delete;
+
+    uint64_t prepareWait();
+    void cancelWait();
+    bool waitUntil(uint64_t key, std::chrono::steady_clock::time_point deadline);
+    void notifyAll();
+
+private:
+    std::atomic<uint32_t> _waiters;
+    std::atomic<uint64_t> _epoch;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+};
+}
+
+#include "EventCount.ipp"
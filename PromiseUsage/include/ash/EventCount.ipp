@@ -0,0 +1,45 @@
+#pragma once
+
+namespace ash::impl {
+inline EventCount::EventCount() : _waiters(0)
+                                , _epoch(0)
+{}
+
+inline uint64_t EventCount::prepareWait()
+{
+    // seq_cst: pairs with the fence in notifyAll(), so either the waiter sees
+    // the new state when it checks its condition or the notifier sees it
+    _waiters.fetch_add(1, std::memory_order_seq_cst);
+    return _epoch.load(std::memory_order_seq_cst);
+}
+
+inline void EventCount::cancelWait()
+{
+    _waiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+inline bool EventCount::waitUntil(uint64_t key, std::chrono::steady_clock::time_point deadline)
+{
+    std::unique_lock lock(_mutex);
+    bool notified = _cv.wait_until(lock, deadline, [this, key]()
+    {
+        return _epoch.load(std::memory_order_relaxed) != key;
+    });
+    _waiters.fetch_sub(1, std::memory_order_relaxed);
+    return notified;
+}
+
+inline void EventCount::notifyAll()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_waiters.load(std::memory_order_relaxed) == 0)
+    {
+        return;
+    }
+    {
+        std::lock_guard lock(_mutex);
+        _epoch.fetch_add(1, std::memory_order_relaxed);
+    }
+    _cv.notify_all();
+}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "Executor.hpp"
+#include "Future.hpp"
+#include "Task.hpp"
+
+namespace ash {
+// Single-threaded executor: callbacks posted from any thread run one after the
+// other on the thread calling run(). Coroutines running on the loop that
+// co_await a future are resumed on the loop once the future is ready, so any
+// number of request flows can wait concurrently without polling and without a
+// thread each. The loop must outlive the coroutines and callbacks posted to it.
+class EventLoop : public Executor
+{
+public:
+    EventLoop() = default;
+    EventLoop(const EventLoop& other) = delete;
+    EventLoop& operator=(const EventLoop& other) = delete;
+
+    // Thread-safe
+    void execute(Callback callback) override;
+
+    // Starts the task on the loop; the future gets its result
+    template<class T>
+    Future<T> spawn(Task<T> task);
+
+    // Runs posted callbacks until stop() is called
+    void run();
+    // Makes run() return once the callbacks it has already taken are done;
+    // the ones posted later stay queued for the next run()
+    void stop();
+
+    // Runs the loop until task completes and returns its result
+    template<class T>
+    T runUntilComplete(Task<T> task);
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::vector<Callback> _callbacks;
+    bool _stopRequested = false;
+};
+}
+
+#include "EventLoop.ipp"
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <utility>
+
+#include "Promise.hpp"
+
+namespace ash {
+namespace impl {
+// Coroutine that starts right away and frees itself when done
+struct DetachedTask
+{
+    struct promise_type
+    {
+        DetachedTask get_return_object() const;
+        std::suspend_never initial_suspend() const noexcept;
+        std::suspend_never final_suspend() const noexcept;
+        void return_void() const;
+        void unhandled_exception() const;
+    };
+};
+
+inline DetachedTask DetachedTask::promise_type::get_return_object() const
+{
+    return {};
+}
+
+inline std::suspend_never DetachedTask::promise_type::initial_suspend() const noexcept
+{
+    return {};
+}
+
+inline std::suspend_never DetachedTask::promise_type::final_suspend() const noexcept
+{
+    return {};
+}
+
+inline void DetachedTask::promise_type::return_void() const
+{}
+
+inline void DetachedTask::promise_type::unhandled_exception() const
+{
+    std::terminate();
+}
+
+template<class T>
+DetachedTask completeWith(Task<T> task, Promise<T> promise)
+{
+    std::exception_ptr exception;
+    try
+    {
+        promise.setValue(co_await std::move(task));
+    }
+    catch (...)
+    {
+        exception = std::current_exception();
+    }
+    if (exception)
+    {
+        promise.setException(exception);
+    }
+}
+}
+
+inline void EventLoop::execute(Callback callback)
+{
+    {
+        std::lock_guard lock(_mutex);
+        _callbacks.push_back(std::move(callback));
+    }
+    _cv.notify_one();
+}
+
+template<class T>
+Future<T> EventLoop::spawn(Task<T> task)
+{
+    static_assert(!std::is_void_v<T>, "Future<void> is not supported: the task must return a value");
+    Promise<T> promise;
+    auto future = promise.getFuture();
+    execute([task = std::move(task), promise = std::move(promise)]() mutable
+    {
+        impl::completeWith(std::move(task), std::move(promise));
+    });
+    return future;
+}
+
+inline void EventLoop::run()
+{
+    impl::CurrentExecutorScope scope(this);
+    std::vector<Callback> batch;
+    for (;;)
+    {
+        {
+            std::unique_lock lock(_mutex);
+            _cv.wait(lock, [this]() { return _stopRequested || !_callbacks.empty(); });
+            if (_stopRequested)
+            {
+                _stopRequested = false;
+                return;
+            }
+            std::swap(batch, _callbacks);
+        }
+        for (auto& callback : batch)
+        {
+            callback();
+        }
+        batch.clear();
+    }
+}
+
+inline void EventLoop::stop()
+{
+    {
+        std::lock_guard lock(_mutex);
+        _stopRequested = true;
+    }
+    _cv.notify_one();
+}
+
+template<class T>
+T EventLoop::runUntilComplete(Task<T> task)
+{
+    auto result = spawn(std::move(task)).then([this](Future<T> future)
+    {
+        stop();
+        return future.get();
+    });
+    run();
+    return result.get();
+}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Callback.hpp"
+
+namespace ash {
+// Runs the continuations attached with Future::then().
+class Executor
+{
+public:
+    virtual ~Executor() = default;
+    virtual void execute(Callback callback) = 0;
+};
+
+// Runs the callback right away on the calling thread, i.e. on the thread that
+// completes the promise, or on the thread calling then() if it already was.
+class InlineExecutor : public Executor
+{
+public:
+    void execute(Callback callback) override;
+};
+
+InlineExecutor& inlineExecutor();
+
+// Executor driving the calling thread, e.g. the EventLoop running on it, or
+// nullptr. Coroutines suspended on a future are resumed on it.
+Executor* currentExecutor();
+
+namespace impl {
+// Makes executor the current executor of the calling thread until destroyed
+class CurrentExecutorScope
+{
+public:
+    explicit CurrentExecutorScope(Executor* executor);
+    CurrentExecutorScope(const CurrentExecutorScope& other) = delete;
+    CurrentExecutorScope& operator=(const CurrentExecutorScope& other) = delete;
+    ~CurrentExecutorScope();
+
+private:
+    Executor* _previous;
+};
+}
+}
+
+#include "Executor.ipp"
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <utility>
+
+namespace ash {
+inline void InlineExecutor::execute(Callback callback)
+{
+    callback();
+}
+
+inline InlineExecutor& inlineExecutor()
+{
+    static InlineExecutor executor;
+    return executor;
+}
+
+namespace impl {
+inline Executor*& currentExecutorSlot()
+{
+    thread_local Executor* executor = nullptr;
+    return executor;
+}
+
+inline CurrentExecutorScope::CurrentExecutorScope(Executor* executor)
+    : _previous(std::exchange(currentExecutorSlot(), executor))
+{}
+
+inline CurrentExecutorScope::~CurrentExecutorScope()
+{
+    currentExecutorSlot() = _previous;
+}
+}
+
+inline Executor* currentExecutor()
+{
+    return impl::currentExecutorSlot();
+}
+}
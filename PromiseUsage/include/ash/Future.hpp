@@ -1,13 +1,37 @@
 #pragma once
 
+#include <coroutine>
+#include <cstddef>
 #include <optional>
+#include <system_error>
+#include <type_traits>
+#include <vector>
 
+#include "Executor.hpp"
 #include "SharedState.hpp"
 
 namespace ash {
 template<class T>
 class Promise;
 
+template<class T>
+class Future;
+
+template<class T>
+struct WhenAnyResult
+{
+    size_t index;
+    std::vector<Future<T>> futures;
+};
+
+// Ready once all of the futures are; they are handed back ready.
+template<class T>
+Future<std::vector<Future<T>>> whenAll(std::vector<Future<T>> futures);
+
+// Ready once any of the futures is, with index telling which.
+template<class T>
+Future<WhenAnyResult<T>> whenAny(std::vector<Future<T>> futures);
+
 template<class T>
 class Future
 {
@@ -18,12 +42,50 @@ public:
     Future& operator=(Future&& other) noexcept;
     bool isValid() const;
     bool isReady() const;
+    // Blocks until the value or exception is set, sleeping instead of spinning
+    void wait() const;
     std::optional<T> tryGet();
     T get();
+    // Waits like get() but leaves the future valid: the code set with
+    // Promise::setError, broken_promise if the promise was dropped, or an
+    // empty code if there is a value or an exception. Lets callers check
+    // for failure without an exception being thrown.
+    std::error_code error() const;
+
+    // Consumes this future. Once it is ready, fn(readyFuture) runs on the
+    // executor and its result, or what it throws, completes the returned future.
+    template<class F>
+    Future<std::invoke_result_t<F, Future<T>>> then(Executor& executor, F&& fn);
+
+    // Runs fn on the thread that completes the promise
+    template<class F>
+    Future<std::invoke_result_t<F, Future<T>>> then(F&& fn);
+
+    // co_await future: suspends until the future is ready, then resumes on
+    // the current executor of the awaiting thread (inline if there is none)
+    // and yields get()
+    class Awaiter
+    {
+    public:
+        explicit Awaiter(Future& future);
+        bool await_ready() const;
+        void await_suspend(std::coroutine_handle<> handle);
+        T await_resume();
+
+    private:
+        Future& _future;
+    };
+
+    Awaiter operator co_await();
+
     ~Future();
 
 private:
     friend Promise<T>;
+    template<class U>
+    friend Future<std::vector<Future<U>>> whenAll(std::vector<Future<U>> futures);
+    template<class U>
+    friend Future<WhenAnyResult<U>> whenAny(std::vector<Future<U>> futures);
 
     void decreaseRefCount();
     explicit Future(impl::SharedState<T>* sharedState);
@@ -33,4 +95,3 @@ private:
 }
 
 #include "Future.ipp"
-
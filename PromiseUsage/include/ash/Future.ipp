@@ -1,5 +1,11 @@
 #pragma once
+#include <functional>
 #include <future>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "Promise.hpp"
 
 namespace ash {
 template<class T>
@@ -32,7 +38,17 @@ bool Future<T>::isValid() const
 template<class T>
 bool Future<T>::isReady() const
 {
-    return isValid() && _sharedState->ready.load(std::memory_order_acquire);
+    return isValid() && _sharedState->isReady();
+}
+
+template<class T>
+void Future<T>::wait() const
+{
+    if (!_sharedState)
+    {
+        throw std::future_error(std::future_errc::no_state);
+    }
+    _sharedState->wait();
 }
 
 template<class T>
@@ -53,15 +69,117 @@ T Future<T>::get()
     {
         throw std::future_error(std::future_errc::no_state);
     }
-    if (_sharedState->exception)
+    _sharedState->wait();
+    switch (_sharedState->result())
+    {
+    case impl::SharedState<T>::HAS_VALUE:
+    {
+        auto value = std::move(_sharedState->value);
+        decreaseRefCount();
+        return value;
+    }
+    case impl::SharedState<T>::HAS_ERROR:
+    {
+        auto error = _sharedState->error;
+        decreaseRefCount();
+        impl::throwError(error);
+    }
+    default:
     {
         auto exception = std::move(_sharedState->exception);
         decreaseRefCount();
         std::rethrow_exception(exception);
     }
-    auto value = std::move(*std::launder(reinterpret_cast<T*>(&_sharedState->value)));
-    decreaseRefCount();
-    return value;
+    }
+}
+
+template<class T>
+std::error_code Future<T>::error() const
+{
+    wait();
+    if (_sharedState->result() == impl::SharedState<T>::HAS_ERROR)
+    {
+        return _sharedState->error;
+    }
+    return {};
+}
+
+template<class T>
+template<class F>
+Future<std::invoke_result_t<F, Future<T>>> Future<T>::then(Executor& executor, F&& fn)
+{
+    using R = std::invoke_result_t<F, Future<T>>;
+    static_assert(!std::is_void_v<R>, "Future<void> is not supported: the continuation must return a value");
+    if (!_sharedState)
+    {
+        throw std::future_error(std::future_errc::no_state);
+    }
+    Promise<R> promise;
+    auto result = promise.getFuture();
+    auto* sharedState = _sharedState;
+    sharedState->setContinuation(
+        [future = std::move(*this), promise = std::move(promise), fn = std::forward<F>(fn), &executor]() mutable
+        {
+            executor.execute(
+                [future = std::move(future), promise = std::move(promise), fn = std::move(fn)]() mutable
+                {
+                    try
+                    {
+                        promise.setValue(std::invoke(fn, std::move(future)));
+                    }
+                    catch (...)
+                    {
+                        promise.setException(std::current_exception());
+                    }
+                });
+        });
+    return result;
+}
+
+template<class T>
+template<class F>
+Future<std::invoke_result_t<F, Future<T>>> Future<T>::then(F&& fn)
+{
+    return then(inlineExecutor(), std::forward<F>(fn));
+}
+
+template<class T>
+Future<T>::Awaiter::Awaiter(Future& future) : _future(future)
+{}
+
+template<class T>
+bool Future<T>::Awaiter::await_ready() const
+{
+    return !_future.isValid() || _future.isReady();
+}
+
+template<class T>
+void Future<T>::Awaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    auto* executor = currentExecutor();
+    _future._sharedState->setContinuation([handle, executor]()
+    {
+        if (executor)
+        {
+            executor->execute([handle]() { handle.resume(); });
+        }
+        else
+        {
+            handle.resume();
+        }
+    });
+}
+
+template<class T>
+T Future<T>::Awaiter::await_resume()
+{
+    return _future.get();
+}
+
+template<class T>
+typename Future<T>::Awaiter Future<T>::operator co_await()
+{
+    return Awaiter(*this);
 }
 
 template<class T>
@@ -76,10 +194,8 @@ Future<T>::~Future()
 template<class T>
 void Future<T>::decreaseRefCount()
 {
-    if (_sharedState->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
-    {
-        delete _sharedState;
-    }
+    // get() releases the state too, so the destructor must not do it again
+    std::exchange(_sharedState, nullptr)->decreaseRefCount();
 }
 
 template<class T>
@@ -87,4 +203,100 @@ Future<T>::Future(impl::SharedState<T>* sharedState) : _sharedState(sharedState)
 {
     sharedState->refCount.fetch_add(1, std::memory_order_release);
 }
+
+template<class T>
+Future<std::vector<Future<T>>> whenAll(std::vector<Future<T>> futures)
+{
+    struct Context
+    {
+        std::vector<Future<T>> futures;
+        std::atomic<size_t> remaining;
+        Promise<std::vector<Future<T>>> promise;
+    };
+    std::vector<impl::SharedState<T>*> sharedStates;
+    sharedStates.reserve(futures.size());
+    for (auto& future : futures)
+    {
+        if (!future._sharedState)
+        {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        sharedStates.push_back(future._sharedState);
+    }
+    auto context = std::make_shared<Context>();
+    auto result = context->promise.getFuture();
+    if (futures.empty())
+    {
+        context->promise.setValue(std::move(futures));
+        return result;
+    }
+    context->remaining.store(futures.size(), std::memory_order_relaxed);
+    context->futures = std::move(futures);
+    for (auto* sharedState : sharedStates)
+    {
+        sharedState->setContinuation([context]()
+        {
+            if (context->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                context->promise.setValue(std::move(context->futures));
+            }
+        });
+    }
+    return result;
+}
+
+template<class T>
+Future<WhenAnyResult<T>> whenAny(std::vector<Future<T>> futures)
+{
+    struct Context
+    {
+        std::vector<Future<T>> futures;
+        std::vector<impl::SharedState<T>*> sharedStates;
+        std::atomic_bool done;
+        Promise<WhenAnyResult<T>> promise;
+    };
+    if (futures.empty())
+    {
+        throw std::invalid_argument("whenAny: no futures");
+    }
+    auto context = std::make_shared<Context>();
+    context->sharedStates.reserve(futures.size());
+    for (auto& future : futures)
+    {
+        if (!future._sharedState)
+        {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        context->sharedStates.push_back(future._sharedState);
+    }
+    auto result = context->promise.getFuture();
+    context->done.store(false, std::memory_order_relaxed);
+    context->futures = std::move(futures);
+    // The states outlive this loop even once a continuation has moved the
+    // futures out: they then belong to the value of result
+    auto& sharedStates = context->sharedStates;
+    for (size_t i = 0; i < sharedStates.size(); ++i)
+    {
+        sharedStates[i]->setContinuation([context, i]()
+        {
+            if (!context->done.exchange(true, std::memory_order_seq_cst))
+            {
+                // The futures that did not win are handed back without the
+                // continuation, so that then() or co_await can be used on them
+                for (auto* sharedState : context->sharedStates)
+                {
+                    sharedState->detachContinuation();
+                }
+                context->promise.setValue(WhenAnyResult<T>{i, std::move(context->futures)});
+            }
+        });
+        // The winner may have detached the continuations before this one was set
+        if (context->done.load(std::memory_order_seq_cst))
+        {
+            sharedStates[i]->detachContinuation();
+            break;
+        }
+    }
+    return result;
+}
 }
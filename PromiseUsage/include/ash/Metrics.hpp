@@ -0,0 +1,127 @@
+#pragma once
+
+// #define ASH_DISABLE_METRICS
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace ash {
+#ifdef ASH_DISABLE_METRICS
+inline constexpr bool METRICS_ENABLED = false;
+#else
+inline constexpr bool METRICS_ENABLED = true;
+#endif
+
+// Log-linear histogram of durations in the spirit of HdrHistogram: exact below
+// 64 ns, then 32 buckets per power of two, so any recorded value is reported
+// within about 3%. Durations are clamped to 2^40 ns (about 18 minutes).
+class LatencyHistogram
+{
+public:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKET_COUNT = uint64_t(1) << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT = 40;
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKET_COUNT;
+
+    static size_t bucketIndex(uint64_t ns);
+    // Largest value that lands in the bucket
+    static uint64_t bucketUpperBound(size_t index);
+
+    void add(size_t index, uint64_t count);
+    void updateMax(uint64_t ns);
+    uint64_t count() const;
+    // Upper bound of the bucket holding the value below which a fraction p of the values lie
+    std::chrono::nanoseconds percentile(double p) const;
+    std::chrono::nanoseconds max() const;
+
+private:
+    std::array<uint64_t, BUCKET_COUNT> _buckets{};
+    uint64_t _count = 0;
+    uint64_t _maxNs = 0;
+};
+
+// Counters and latencies of a Module since it started, summed over the threads
+// that recorded them. The gauges are derived from the counters, which are read
+// one by one, so they can be briefly off by the requests in flight.
+struct MetricsSnapshot
+{
+    uint64_t posted = 0;
+    uint64_t activated = 0;   // taken from a request buffer by a worker
+    uint64_t fulfilled = 0;
+    uint64_t dropped = 0;     // pending when the Module was destroyed
+    uint64_t stolen = 0;      // fulfilled by another worker than the one they were posted to
+
+    uint64_t queueDepth = 0;  // posted but not activated
+    uint64_t active = 0;      // activated but neither fulfilled nor dropped
+
+    LatencyHistogram queueWait;   // enqueue -> activate
+    LatencyHistogram lateness;    // deadline -> fulfil
+    LatencyHistogram total;       // enqueue -> fulfil
+};
+
+namespace impl {
+// Each thread records into a shard of its own with plain relaxed stores, so
+// recording never contends; snapshot() walks the shards without any lock.
+// Compiled to nothing when ASH_DISABLE_METRICS is defined.
+class MetricsRecorder
+{
+public:
+    enum Counter
+    {
+        POSTED,
+        ACTIVATED,
+        FULFILLED,
+        DROPPED,
+        STOLEN,
+        COUNTER_COUNT
+    };
+
+    enum Latency
+    {
+        QUEUE_WAIT,
+        LATENESS,
+        TOTAL,
+        LATENCY_COUNT
+    };
+
+    MetricsRecorder();
+    MetricsRecorder(const MetricsRecorder& other) = delete;
+    MetricsRecorder& operator=(const MetricsRecorder& other) = delete;
+    ~MetricsRecorder();
+
+    void add(Counter counter, uint64_t count = 1);
+    void record(Latency latency, std::chrono::steady_clock::duration duration);
+    MetricsSnapshot snapshot() const;
+
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> counters[COUNTER_COUNT] = {};
+        std::atomic<uint64_t> maxNs[LATENCY_COUNT] = {};
+        std::atomic<uint64_t> buckets[LATENCY_COUNT][LatencyHistogram::BUCKET_COUNT] = {};
+        Shard* next = nullptr;
+    };
+
+    struct CachedShard
+    {
+        uint64_t recorderId;
+        Shard* shard;
+    };
+
+    static constexpr size_t MAX_CACHED_SHARDS = 64;
+
+    Shard& localShard();
+    static void increment(std::atomic<uint64_t>& value, uint64_t count);
+
+    // Never reused, unlike addresses, so a thread's cache can't pick the
+    // shard of a destroyed recorder
+    const uint64_t _id;
+    std::atomic<Shard*> _shards;
+};
+}
+}
+
+#include "Metrics.ipp"
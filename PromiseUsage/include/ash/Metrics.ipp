@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace ash {
+inline size_t LatencyHistogram::bucketIndex(uint64_t ns)
+{
+    ns = std::min(ns, (uint64_t(1) << MAX_EXPONENT) - 1);
+    if (ns < SUB_BUCKET_COUNT)
+    {
+        return static_cast<size_t>(ns);
+    }
+    auto exponent = 63 - __builtin_clzll(ns);
+    auto shift = exponent - SUB_BUCKET_BITS;
+    auto top = ns >> shift;
+    return static_cast<size_t>((shift + 1) * SUB_BUCKET_COUNT + (top - SUB_BUCKET_COUNT));
+}
+
+inline uint64_t LatencyHistogram::bucketUpperBound(size_t index)
+{
+    if (index < 2 * SUB_BUCKET_COUNT)
+    {
+        return index;
+    }
+    auto shift = index / SUB_BUCKET_COUNT - 1;
+    auto top = index % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT;
+    return ((top + 1) << shift) - 1;
+}
+
+inline void LatencyHistogram::add(size_t index, uint64_t count)
+{
+    _buckets[index] += count;
+    _count += count;
+}
+
+inline void LatencyHistogram::updateMax(uint64_t ns)
+{
+    _maxNs = std::max(_maxNs, ns);
+}
+
+inline uint64_t LatencyHistogram::count() const
+{
+    return _count;
+}
+
+inline std::chrono::nanoseconds LatencyHistogram::percentile(double p) const
+{
+    if (_count == 0)
+    {
+        return std::chrono::nanoseconds(0);
+    }
+    auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * static_cast<double>(_count))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i)
+    {
+        seen += _buckets[i];
+        if (seen >= rank)
+        {
+            return std::chrono::nanoseconds(std::min(bucketUpperBound(i), _maxNs));
+        }
+    }
+    return max();
+}
+
+inline std::chrono::nanoseconds LatencyHistogram::max() const
+{
+    return std::chrono::nanoseconds(_maxNs);
+}
+
+namespace impl {
+inline MetricsRecorder::MetricsRecorder() : _id([]()
+                                            {
+                                                static std::atomic<uint64_t> nextId(1);
+                                                return nextId.fetch_add(1, std::memory_order_relaxed);
+                                            }())
+                                          , _shards(nullptr)
+{}
+
+inline MetricsRecorder::~MetricsRecorder()
+{
+    auto* shard = _shards.load(std::memory_order_acquire);
+    while (shard)
+    {
+        delete std::exchange(shard, shard->next);
+    }
+}
+
+inline void MetricsRecorder::add(Counter counter, uint64_t count)
+{
+    if constexpr (METRICS_ENABLED)
+    {
+        increment(localShard().counters[counter], count);
+    }
+}
+
+inline void MetricsRecorder::record(Latency latency, std::chrono::steady_clock::duration duration)
+{
+    if constexpr (METRICS_ENABLED)
+    {
+        auto ns = static_cast<uint64_t>(
+            std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+        auto& shard = localShard();
+        increment(shard.buckets[latency][LatencyHistogram::bucketIndex(ns)], 1);
+        if (ns > shard.maxNs[latency].load(std::memory_order_relaxed))
+        {
+            shard.maxNs[latency].store(ns, std::memory_order_relaxed);
+        }
+    }
+}
+
+inline MetricsSnapshot MetricsRecorder::snapshot() const
+{
+    MetricsSnapshot snapshot;
+    uint64_t counters[COUNTER_COUNT] = {};
+    LatencyHistogram* histograms[LATENCY_COUNT] = {&snapshot.queueWait, &snapshot.lateness, &snapshot.total};
+    for (auto* shard = _shards.load(std::memory_order_acquire); shard; shard = shard->next)
+    {
+        for (int c = 0; c < COUNTER_COUNT; ++c)
+        {
+            counters[c] += shard->counters[c].load(std::memory_order_relaxed);
+        }
+        for (int l = 0; l < LATENCY_COUNT; ++l)
+        {
+            for (size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i)
+            {
+                if (auto count = shard->buckets[l][i].load(std::memory_order_relaxed))
+                {
+                    histograms[l]->add(i, count);
+                }
+            }
+            histograms[l]->updateMax(shard->maxNs[l].load(std::memory_order_relaxed));
+        }
+    }
+    snapshot.posted = counters[POSTED];
+    snapshot.activated = counters[ACTIVATED];
+    snapshot.fulfilled = counters[FULFILLED];
+    snapshot.dropped = counters[DROPPED];
+    snapshot.stolen = counters[STOLEN];
+    auto done = snapshot.fulfilled + snapshot.dropped;
+    snapshot.queueDepth = snapshot.posted > snapshot.activated ? snapshot.posted - snapshot.activated : 0;
+    snapshot.active = snapshot.activated > done ? snapshot.activated - done : 0;
+    return snapshot;
+}
+
+inline MetricsRecorder::Shard& MetricsRecorder::localShard()
+{
+    // Most threads only ever record into one recorder
+    thread_local CachedShard last{0, nullptr};
+    if (last.recorderId == _id)
+    {
+        return *last.shard;
+    }
+    thread_local std::vector<CachedShard> cache;
+    for (auto& cached : cache)
+    {
+        if (cached.recorderId == _id)
+        {
+            last = cached;
+            return *cached.shard;
+        }
+    }
+    if (cache.size() == MAX_CACHED_SHARDS)
+    {
+        // Mostly recorders that are gone; a live one evicted here just gets
+        // another shard from this thread
+        cache.erase(cache.begin(), cache.begin() + MAX_CACHED_SHARDS / 2);
+    }
+    auto* shard = new Shard;
+    shard->next = _shards.load(std::memory_order_relaxed);
+    while (!_shards.compare_exchange_weak(shard->next, shard, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+    cache.push_back({_id, shard});
+    last = cache.back();
+    return *shard;
+}
+
+inline void MetricsRecorder::increment(std::atomic<uint64_t>& value, uint64_t count)
+{
+    // Only the owning thread writes to its shard: no read-modify-write needed
+    value.store(value.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+}
+}
+}
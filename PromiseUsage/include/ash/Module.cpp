@@ -1,18 +1,22 @@
 #include "Module.hpp"
 
+#include <algorithm>
 #include <functional>
 #include <iostream>
+#include <mutex>
+#include <new>
 #include <ostream>
 #include <random>
+#include <stdexcept>
 #include <thread>
+#include <utility>
 
 using namespace ash;
 
 namespace {
-std::mt19937 rng(std::random_device{}());
-std::uniform_int_distribution unif(1000, 2000);
+thread_local std::mt19937 rng(std::random_device{}());
 constexpr int BUFFER_SIZE = 1000;
-constexpr int PERIOD_MS = 25;
+constexpr size_t BATCH_SIZE = 256;
 
 inline std::future<int> getFuture(std::promise<int>& promise)
 {
@@ -35,56 +39,318 @@ inline void setValue(Promise<int>& promise, int value)
 }
 }
 
-Module::Module()
-    : _requestBuffer(BUFFER_SIZE)
-    , _requestStop(false)
+class Module::RequestPool
 {
-    _worker = std::thread(std::bind(&Module::run, this));
+public:
+    void* allocate();
+    void deallocate(void* slot);
+
+private:
+    static constexpr size_t CHUNK_SIZE = 256;
+
+    struct alignas(Request) Slot
+    {
+        unsigned char bytes[sizeof(Request)];
+    };
+
+    std::mutex _mutex;
+    std::vector<std::unique_ptr<Slot[]>> _chunks;
+    std::vector<Slot*> _free;
+};
+
+void* Module::RequestPool::allocate()
+{
+    std::lock_guard lock(_mutex);
+    if (_free.empty())
+    {
+        _chunks.emplace_back(new Slot[CHUNK_SIZE]);
+        _free.reserve(_chunks.size() * CHUNK_SIZE);
+        for (size_t i = CHUNK_SIZE; i > 0; --i)
+        {
+            _free.push_back(&_chunks.back()[i - 1]);
+        }
+    }
+    auto* slot = _free.back();
+    _free.pop_back();
+    return slot;
+}
+
+void Module::RequestPool::deallocate(void* slot)
+{
+    std::lock_guard lock(_mutex);
+    _free.push_back(static_cast<Slot*>(slot));
+}
+
+Module::Request::Request(std::shared_ptr<RequestPool> pool)
+#ifdef USE_STD_FUTURE
+    : request(0)
+#else
+    : RequestState(&Module::deleteRequest)
+    , promise(this)
+    , request(0)
+#endif
+    , pool(std::move(pool))
+{}
+
+Module::Worker::Worker(size_t index, size_t bufferSize) : index(index)
+                                                         , requestBuffer(bufferSize)
+                                                         , idle(false)
+{}
+
+Module::Module(size_t numberOfWorkers, std::chrono::milliseconds minDelay, std::chrono::milliseconds maxDelay)
+    : _requestPool(std::make_shared<RequestPool>())
+    , _nextWorker(0)
+    , _minDelayMs(static_cast<int>(minDelay.count()))
+    , _maxDelayMs(static_cast<int>(maxDelay.count()))
+{
+    if (numberOfWorkers == 0)
+    {
+        throw std::invalid_argument("Module needs at least one worker");
+    }
+    for (size_t i = 0; i < numberOfWorkers; ++i)
+    {
+        _workers.push_back(std::make_unique<Worker>(i, BUFFER_SIZE));
+    }
+    for (auto& worker : _workers)
+    {
+        worker->thread = std::thread(std::bind(&Module::run, this, std::ref(*worker)));
+    }
 }
 
 Module::DelayedResponse Module::postRequest(int x)
 {
-    Request request;
-    request.request = x;
-    request.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(unif(rng));
-    auto future = getFuture(request.promise);
-    _requestBuffer.push(std::move(request));
+    auto* request = newRequest(x, std::chrono::steady_clock::now());
+    auto future = getFuture(request->promise);
+    _metrics.add(impl::MetricsRecorder::POSTED);
+    nextWorker().requestBuffer.push(request);
     return future;
 }
 
+std::vector<Module::DelayedResponse> Module::postRequests(const std::vector<int>& xs)
+{
+    std::vector<Request*> requests(xs.size());
+    std::vector<DelayedResponse> futures;
+    futures.reserve(xs.size());
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < xs.size(); ++i)
+    {
+        requests[i] = newRequest(xs[i], now);
+        futures.push_back(getFuture(requests[i]->promise));
+    }
+    _metrics.add(impl::MetricsRecorder::POSTED, requests.size());
+    auto runSize = (requests.size() + _workers.size() - 1) / _workers.size();
+    for (auto first = requests.begin(); first != requests.end();)
+    {
+        auto last = first + std::min<size_t>(runSize, requests.end() - first);
+        nextWorker().requestBuffer.pushBulk(first, last);
+        first = last;
+    }
+    return futures;
+}
+
 Module::~Module()
 {
-    std::cout << "Beginning Module::~Module()" << std::endl;
-    _requestStop = true;
-    _worker.join();
-    std::cout << "End Module::~Module()" << std::endl;
+    std::clog << "Beginning Module::~Module()" << std::endl;
+    // Queued behind the pending requests: each worker stops once it has taken them
+    for (auto& worker : _workers)
+    {
+        worker->requestBuffer.push(nullptr);
+    }
+    for (auto& worker : _workers)
+    {
+        worker->thread.join();
+    }
+    // Requests that are due are answered, the others are dropped and their
+    // futures get broken_promise, as an error code so that no exception is
+    // created for them unless a future is read with get()
+    for (auto& worker : _workers)
+    {
+        while (auto request = worker->due.pop())
+        {
+            complete(*request, false);
+        }
+        _metrics.add(impl::MetricsRecorder::DROPPED, worker->timers.size());
+        worker->timers.drain(&Module::retire);
+    }
+    std::clog << "End Module::~Module()" << std::endl;
 }
 
-void Module::run()
+void Module::run(Worker& worker)
 {
-    while (!_requestStop.load(std::memory_order_relaxed))
+    Request* batch[BATCH_SIZE];
+    for (;;)
     {
-        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(PERIOD_MS);
-        tick();
-        std::this_thread::sleep_until(deadline);
+        auto now = std::chrono::steady_clock::now();
+        expire(worker, now);
+        while (auto request = worker.due.pop())
+        {
+            complete(*request, false);
+        }
+        if (steal(worker))
+        {
+            continue;
+        }
+        // Sleep until the next deadline, until new requests come in or until
+        // a busy worker has requests to steal
+        auto timeoutMs = worker.timers.empty() ?
+                             std::chrono::milliseconds::max() :
+                             std::chrono::ceil<std::chrono::milliseconds>(worker.timers.nextDeadline() - now);
+        worker.idle.store(true, std::memory_order_relaxed);
+        auto count = worker.requestBuffer.popInto(batch, BATCH_SIZE, timeoutMs);
+        worker.idle.store(false, std::memory_order_relaxed);
+        recordActivation(batch, count);
+        bool stop = false;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (!batch[i])
+            {
+                stop = true;
+            }
+            else if (batch[i] != wakeUpToken())
+            {
+                worker.timers.push(batch[i]->deadline, batch[i]);
+            }
+        }
+        if (stop)
+        {
+            return;
+        }
     }
 }
 
-void Module::tick()
+void Module::expire(Worker& worker, std::chrono::steady_clock::time_point now)
 {
-    auto now = std::chrono::steady_clock::now();
-    for (auto requestIt = _activeRequests.begin(); requestIt != _activeRequests.end();)
+    size_t count = 0;
+    while (!worker.timers.empty() && worker.timers.nextDeadline() <= now)
+    {
+        worker.due.push(worker.timers.pop());
+        ++count;
+    }
+    if (count > 1)
+    {
+        wakeIdleWorkers(worker, count - 1);
+    }
+}
+
+bool Module::steal(const Worker& thief)
+{
+    if (_workers.size() == 1)
+    {
+        return false;
+    }
+    for (size_t i = 1; i < _workers.size(); ++i)
+    {
+        auto& victim = *_workers[(thief.index + i) % _workers.size()];
+        if (auto request = victim.due.steal())
+        {
+            complete(*request, true);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Module::wakeIdleWorkers(const Worker& busy, size_t count)
+{
+    for (auto& worker : _workers)
+    {
+        if (count == 0)
+        {
+            break;
+        }
+        // A worker that missed the wake up is not idle, so it steals before sleeping again
+        if (worker.get() != &busy && worker->idle.load(std::memory_order_relaxed) &&
+            worker->requestBuffer.tryPush(wakeUpToken()))
+        {
+            --count;
+        }
+    }
+}
+
+MetricsSnapshot Module::metrics() const
+{
+    return _metrics.snapshot();
+}
+
+Module::Worker& Module::nextWorker()
+{
+    return *_workers[_nextWorker.fetch_add(1, std::memory_order_relaxed) % _workers.size()];
+}
+
+// Queued to a worker, nullptr stops it while this only wakes it up to steal
+Module::Request* Module::wakeUpToken()
+{
+    alignas(Request) static unsigned char storage[sizeof(Request)];
+    return reinterpret_cast<Request*>(storage);
+}
+
+Module::Request* Module::newRequest(int x, std::chrono::steady_clock::time_point now)
+{
+    auto* request = ::new(_requestPool->allocate()) Request(_requestPool);
+    request->request = x;
+    request->enqueued = now;
+    request->deadline = now + std::chrono::milliseconds(std::uniform_int_distribution(_minDelayMs, _maxDelayMs)(rng));
+    return request;
+}
+
+void Module::complete(Request* request, bool stolen)
+{
+    if constexpr (METRICS_ENABLED)
     {
-        auto& request = *requestIt;
-        if (now >= request.deadline)
+        auto now = std::chrono::steady_clock::now();
+        _metrics.record(impl::MetricsRecorder::LATENESS, now - request->deadline);
+        _metrics.record(impl::MetricsRecorder::TOTAL, now - request->enqueued);
+        _metrics.add(impl::MetricsRecorder::FULFILLED);
+        if (stolen)
         {
-            setValue(request.promise, 2 * request.request);
-            requestIt = _activeRequests.erase(requestIt);
+            _metrics.add(impl::MetricsRecorder::STOLEN);
         }
-        else
+    }
+    setValue(request->promise, 2 * request->request);
+    retire(request);
+}
+
+void Module::recordActivation(Request* const* requests, size_t count)
+{
+    if constexpr (METRICS_ENABLED)
+    {
+        auto now = std::chrono::steady_clock::now();
+        uint64_t activated = 0;
+        for (size_t i = 0; i < count; ++i)
         {
-            ++requestIt;
+            if (requests[i] && requests[i] != wakeUpToken())
+            {
+                _metrics.record(impl::MetricsRecorder::QUEUE_WAIT, now - requests[i]->enqueued);
+                ++activated;
+            }
         }
+        _metrics.add(impl::MetricsRecorder::ACTIVATED, activated);
     }
-    _requestBuffer.popAll(_activeRequests);
 }
+
+void Module::retire(Request* request)
+{
+#ifdef USE_STD_FUTURE
+    destroyRequest(request);
+#else
+    // Drops the promise's reference: the request is destroyed along with the
+    // state once the future is gone too
+    Promise<int> promise(std::move(request->promise));
+#endif
+}
+
+void Module::destroyRequest(Request* request)
+{
+    // The module may be gone already, in which case the pool goes away with
+    // its last request
+    auto pool = std::move(request->pool);
+    request->~Request();
+    pool->deallocate(request);
+}
+
+#ifndef USE_STD_FUTURE
+void Module::deleteRequest(impl::SharedState<int>* state)
+{
+    destroyRequest(static_cast<Request*>(state));
+}
+#endif
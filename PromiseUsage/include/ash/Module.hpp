@@ -2,10 +2,17 @@
 
 // #define USE_STD_FUTURE
 
-#include <list>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
 
+#include "Metrics.hpp"
 #include "Promise.hpp"
 #include "SyncCircularBuffer.hpp"
+#include "TimerHeap.hpp"
+#include "WorkStealingDeque.hpp"
 
 namespace ash {
 inline std::optional<int> tryGet(std::future<int>& future)
@@ -31,13 +38,39 @@ public:
     using DelayedResponse = Future<int>;
 #endif
 
-    Module();
+    // Each request is answered after a random delay in [minDelay, maxDelay].
+    // Requests are spread round-robin over the workers; a worker with many
+    // requests due at once has the idle ones steal part of them.
+    explicit Module(size_t numberOfWorkers = 1,
+                    std::chrono::milliseconds minDelay = std::chrono::milliseconds(1000),
+                    std::chrono::milliseconds maxDelay = std::chrono::milliseconds(2000));
     DelayedResponse postRequest(int x);
+    // Same as calling postRequest for each value, but the batch is split into
+    // one run per worker, each handed over under a single lock acquisition
+    std::vector<DelayedResponse> postRequests(const std::vector<int>& xs);
+    // Lock-free: can be called at any time from any thread. All zeros when
+    // ASH_DISABLE_METRICS is defined.
+    MetricsSnapshot metrics() const;
     ~Module();
 
 private:
-    struct Request
+#ifdef USE_STD_FUTURE
+    struct RequestState
+    {};
+#else
+    // The state of the future is embedded in the request, so that a request
+    // round trip does not allocate
+    using RequestState = impl::SharedState<int>;
+#endif
+
+    class RequestPool;
+
+    // Lives in a slot of the RequestPool until it is retired and, with
+    // ash futures, until the future is gone too
+    struct Request : RequestState
     {
+        explicit Request(std::shared_ptr<RequestPool> pool);
+
 #ifdef USE_STD_FUTURE
         std::promise<int> promise;
 #else
@@ -45,16 +78,46 @@ private:
 #endif
 
         int request;
+        std::chrono::steady_clock::time_point enqueued;
         std::chrono::steady_clock::time_point deadline;
+        std::shared_ptr<RequestPool> pool;
     };
 
-    void run();
-    void tick();
+    struct Worker
+    {
+        Worker(size_t index, size_t bufferSize);
+
+        size_t index;
+        std::thread thread;
+        SyncCircularBuffer<Request*> requestBuffer;
+        // Requests taken from the buffer, owned by the worker
+        impl::TimerHeap<Request*> timers;
+        // Requests past their deadline, completed by the worker or stolen
+        impl::WorkStealingDeque<Request*> due;
+        std::atomic_bool idle;
+    };
+
+    void run(Worker& worker);
+    void expire(Worker& worker, std::chrono::steady_clock::time_point now);
+    bool steal(const Worker& thief);
+    void wakeIdleWorkers(const Worker& busy, size_t count);
+    Worker& nextWorker();
+    static Request* wakeUpToken();
+    Request* newRequest(int x, std::chrono::steady_clock::time_point now);
+    void complete(Request* request, bool stolen);
+    void recordActivation(Request* const* requests, size_t count);
+    static void retire(Request* request);
+    static void destroyRequest(Request* request);
+#ifndef USE_STD_FUTURE
+    static void deleteRequest(impl::SharedState<int>* state);
+#endif
 
-    std::thread _worker;
-    SyncCircularBuffer<Request> _requestBuffer;
-    std::list<Request> _activeRequests;
-    std::atomic_bool _requestStop;
+    std::shared_ptr<RequestPool> _requestPool;
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::atomic<size_t> _nextWorker;
+    int _minDelayMs;
+    int _maxDelayMs;
+    impl::MetricsRecorder _metrics;
 };
 }
 
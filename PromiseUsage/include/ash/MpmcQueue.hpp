@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "BlockingQueue.hpp"
+
+namespace ash {
+// Bounded lock-free queue for any number of producers and consumers
+// (Vyukov's bounded MPMC queue). Every cell carries a sequence number that
+// tells producers and consumers whether it is their turn to use it, so
+// claiming a cell is a single CAS on the enqueue or dequeue position, each
+// on its own cache line. The capacity is the requested size rounded up to a
+// power of two (and at least 2).
+template<class T>
+class MpmcQueue : public impl::BlockingQueue<MpmcQueue<T>, T>
+{
+public:
+    explicit MpmcQueue(size_t size);
+    MpmcQueue(const MpmcQueue& other) = delete;
+    MpmcQueue& operator=(const MpmcQueue& other) = delete;
+    ~MpmcQueue();
+
+    size_t capacity() const;
+
+private:
+    friend impl::BlockingQueue<MpmcQueue<T>, T>;
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        alignas(alignof(T)) unsigned char storage[sizeof(T)];
+
+        T* element();
+    };
+
+    template<class U>
+    bool doTryPush(U&& value);
+    std::optional<T> doTryPop();
+
+    size_t _mask;
+    std::unique_ptr<Cell[]> _cells;
+    alignas(impl::CACHE_LINE_SIZE) std::atomic<size_t> _enqueuePos;
+    alignas(impl::CACHE_LINE_SIZE) std::atomic<size_t> _dequeuePos;
+};
+}
+
+#include "MpmcQueue.ipp"
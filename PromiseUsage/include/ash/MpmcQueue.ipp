@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <new>
+
+namespace ash {
+template<class T>
+MpmcQueue<T>::MpmcQueue(size_t size) : _mask(impl::roundUpToPowerOfTwo(std::max<size_t>(size, 2)) - 1)
+                                     , _cells(new Cell[_mask + 1])
+                                     , _enqueuePos(0)
+                                     , _dequeuePos(0)
+{
+    for (size_t i = 0; i <= _mask; ++i)
+    {
+        _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template<class T>
+MpmcQueue<T>::~MpmcQueue()
+{
+    while (doTryPop())
+    {}
+}
+
+template<class T>
+size_t MpmcQueue<T>::capacity() const
+{
+    return _mask + 1;
+}
+
+template<class T>
+T* MpmcQueue<T>::Cell::element()
+{
+    return std::launder(reinterpret_cast<T*>(storage));
+}
+
+template<class T>
+template<class U>
+bool MpmcQueue<T>::doTryPush(U&& value)
+{
+    Cell* cell;
+    size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &_cells[pos & _mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(sequence - pos);
+        if (diff == 0)
+        {
+            if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = _enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    new(cell->storage) T(std::forward<U>(value));
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template<class T>
+std::optional<T> MpmcQueue<T>::doTryPop()
+{
+    Cell* cell;
+    size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &_cells[pos & _mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(sequence - (pos + 1));
+        if (diff == 0)
+        {
+            if (_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return {};
+        }
+        else
+        {
+            pos = _dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+    T* element = cell->element();
+    std::optional<T> value(std::move(*element));
+    element->~T();
+    cell->sequence.store(pos + _mask + 1, std::memory_order_release);
+    return value;
+}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace ash {
+namespace impl {
+// Free list of blocks of one size, owned by one thread. Each block records
+// its pool in a header, so a block freed on another thread goes back to the
+// pool it came from, through a lock-free list of remote frees that the owner
+// takes over once its own list is empty. When its thread exits, the pool is
+// orphaned: blocks freed from then on go straight to operator delete, and the
+// last of them frees the pool.
+template<std::size_t Size, std::size_t Alignment>
+class BlockPool
+{
+public:
+    static void* allocateBlock();
+    static void deallocateBlock(void* block);
+
+    BlockPool(const BlockPool& other) = delete;
+    BlockPool& operator=(const BlockPool& other) = delete;
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    // Destroys the pool of the calling thread when it exits
+    struct LocalPool
+    {
+        ~LocalPool();
+
+        BlockPool* pool = nullptr;
+    };
+
+    static constexpr std::size_t BLOCK_SIZE = Size < sizeof(FreeBlock) ? sizeof(FreeBlock) : Size;
+    static constexpr std::size_t BLOCK_ALIGNMENT = Alignment < alignof(FreeBlock) ? alignof(FreeBlock) : Alignment;
+    // Holds the owning pool, and keeps the block behind it aligned
+    static constexpr std::size_t HEADER_SIZE = BLOCK_ALIGNMENT < sizeof(BlockPool*) ? sizeof(BlockPool*)
+                                                                                    : BLOCK_ALIGNMENT;
+    // Beyond this, freed blocks go back to operator delete
+    static constexpr std::size_t MAX_FREE_BLOCKS = 1024;
+
+    static LocalPool& local();
+    static BlockPool*& owner(void* block);
+    static void deleteBlock(void* block);
+
+    BlockPool() = default;
+    ~BlockPool() = default;
+
+    void* allocate();
+    void deallocate(void* block);
+    void deallocateRemote(void* block);
+    void takeRemoteFrees();
+    void orphan();
+    // Counts down the blocks still out once orphaned; frees the pool after the last
+    void releaseOrphaned(std::size_t blocks);
+
+    // Owner thread only
+    FreeBlock* _free = nullptr;
+    std::size_t _freeCount = 0;
+    // Blocks handed out and not back in _free yet, remote frees included
+    std::size_t _outstanding = 0;
+
+    // Pushed to by the other threads, ORPHANED once the owner has exited
+    alignas(64) std::atomic<FreeBlock*> _remoteFree{nullptr};
+    std::atomic<std::size_t> _orphanedOutstanding{0};
+
+    static inline FreeBlock ORPHANED{nullptr};
+};
+}
+
+// Stateless allocator serving single objects from the calling thread's
+// BlockPool, e.g. to give Promise a shared state without going through the
+// global allocator on every request, even when the state is freed on the
+// thread that fulfils the promise.
+template<class T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+
+    template<class U>
+    PoolAllocator(const PoolAllocator<U>& other) noexcept;
+
+    T* allocate(std::size_t n);
+    void deallocate(T* pointer, std::size_t n);
+};
+
+template<class T, class U>
+bool operator==(const PoolAllocator<T>& lhs, const PoolAllocator<U>& rhs);
+
+template<class T, class U>
+bool operator!=(const PoolAllocator<T>& lhs, const PoolAllocator<U>& rhs);
+}
+
+#include "PoolAllocator.ipp"
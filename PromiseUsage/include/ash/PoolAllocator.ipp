@@ -0,0 +1,199 @@
+#pragma once
+
+#include <atomic>
+#include <new>
+
+namespace ash {
+namespace impl {
+template<std::size_t Size, std::size_t Alignment>
+void* BlockPool<Size, Alignment>::allocateBlock()
+{
+    auto& local = BlockPool::local();
+    if (!local.pool)
+    {
+        local.pool = new BlockPool();
+    }
+    return local.pool->allocate();
+}
+
+template<std::size_t Size, std::size_t Alignment>
+void BlockPool<Size, Alignment>::deallocateBlock(void* block)
+{
+    auto* pool = owner(block);
+    if (pool == local().pool)
+    {
+        pool->deallocate(block);
+    }
+    else
+    {
+        pool->deallocateRemote(block);
+    }
+}
+
+template<std::size_t Size, std::size_t Alignment>
+BlockPool<Size, Alignment>::LocalPool::~LocalPool()
+{
+    if (pool)
+    {
+        pool->orphan();
+        pool = nullptr;
+    }
+}
+
+template<std::size_t Size, std::size_t Alignment>
+typename BlockPool<Size, Alignment>::LocalPool& BlockPool<Size, Alignment>::local()
+{
+    thread_local LocalPool pool;
+    return pool;
+}
+
+template<std::size_t Size, std::size_t Alignment>
+BlockPool<Size, Alignment>*& BlockPool<Size, Alignment>::owner(void* block)
+{
+    return *reinterpret_cast<BlockPool**>(static_cast<unsigned char*>(block) - HEADER_SIZE);
+}
+
+template<std::size_t Size, std::size_t Alignment>
+void BlockPool<Size, Alignment>::deleteBlock(void* block)
+{
+    ::operator delete(static_cast<unsigned char*>(block) - HEADER_SIZE, std::align_val_t(BLOCK_ALIGNMENT));
+}
+
+template<std::size_t Size, std::size_t Alignment>
+void* BlockPool<Size, Alignment>::allocate()
+{
+    if (!_free)
+    {
+        takeRemoteFrees();
+    }
+    ++_outstanding;
+    if (_free)
+    {
+        auto* block = _free;
+        _free = block->next;
+        --_freeCount;
+        return block;
+    }
+    auto* memory = static_cast<unsigned char*>(::operator new(HEADER_SIZE + BLOCK_SIZE,
+                                                              std::align_val_t(BLOCK_ALIGNMENT)));
+    auto* block = memory + HEADER_SIZE;
+    owner(block) = this;
+    return block;
+}
+
+template<std::size_t Size, std::size_t Alignment>
+void BlockPool<Size, Alignment>::deallocate(void* block)
+{
+    --_outstanding;
+    if (_freeCount == MAX_FREE_BLOCKS)
+    {
+        deleteBlock(block);
+        return;
+    }
+    _free = ::new(block) FreeBlock{_free};
+    ++_freeCount;
+}
+
+template<std::size_t Size, std::size_t Alignment>
+void BlockPool<Size, Alignment>::deallocateRemote(void* block)
+{
+    auto* freeBlock = ::new(block) FreeBlock{_remoteFree.load(std::memory_order_acquire)};
+    while (freeBlock->next != &ORPHANED)
+    {
+        if (_remoteFree.compare_exchange_weak(freeBlock->next, freeBlock, std::memory_order_release,
+                                              std::memory_order_acquire))
+        {
+            return;
+        }
+    }
+    deleteBlock(block);
+    releaseOrphaned(1);
+}
+
+template<std::size_t Size, std::size_t Alignment>
+void BlockPool<Size, Alignment>::takeRemoteFrees()
+{
+    if (!_remoteFree.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    auto* block = _remoteFree.exchange(nullptr, std::memory_order_acquire);
+    while (block)
+    {
+        auto* next = block->next;
+        deallocate(block);
+        block = next;
+    }
+}
+
+template<std::size_t Size, std::size_t Alignment>
+void BlockPool<Size, Alignment>::orphan()
+{
+    while (_free)
+    {
+        auto* next = _free->next;
+        deleteBlock(_free);
+        _free = next;
+    }
+    // Set before ORPHANED is published, so that remote frees seeing it count down from there
+    _orphanedOutstanding.store(_outstanding, std::memory_order_relaxed);
+    auto* block = _remoteFree.exchange(&ORPHANED, std::memory_order_acq_rel);
+    std::size_t taken = 0;
+    while (block)
+    {
+        auto* next = block->next;
+        deleteBlock(block);
+        ++taken;
+        block = next;
+    }
+    releaseOrphaned(taken);
+}
+
+template<std::size_t Size, std::size_t Alignment>
+void BlockPool<Size, Alignment>::releaseOrphaned(std::size_t blocks)
+{
+    if (_orphanedOutstanding.fetch_sub(blocks, std::memory_order_acq_rel) == blocks)
+    {
+        delete this;
+    }
+}
+}
+
+template<class T>
+template<class U>
+PoolAllocator<T>::PoolAllocator(const PoolAllocator<U>&) noexcept
+{}
+
+template<class T>
+T* PoolAllocator<T>::allocate(std::size_t n)
+{
+    if (n == 1)
+    {
+        return static_cast<T*>(impl::BlockPool<sizeof(T), alignof(T)>::allocateBlock());
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+}
+
+template<class T>
+void PoolAllocator<T>::deallocate(T* pointer, std::size_t n)
+{
+    if (n == 1)
+    {
+        impl::BlockPool<sizeof(T), alignof(T)>::deallocateBlock(pointer);
+        return;
+    }
+    ::operator delete(pointer, std::align_val_t(alignof(T)));
+}
+
+template<class T, class U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&)
+{
+    return true;
+}
+
+template<class T, class U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&)
+{
+    return false;
+}
+}
@@ -1,5 +1,8 @@
 #pragma once
+#include <memory>
+
 #include "Future.hpp"
+#include "PoolAllocator.hpp"
 #include "SharedState.hpp"
 
 namespace ash {
@@ -7,17 +10,32 @@ template<class T>
 class Promise
 {
 public:
+    // The shared state comes from the calling thread's PoolAllocator
     Promise();
+
+    template<class Allocator>
+    Promise(std::allocator_arg_t, const Allocator& allocator);
+
+    // Adopts a state constructed by the caller, e.g. embedded in the object
+    // that owns the promise. It is handed to its deleter once the promise and
+    // the future are both gone.
+    explicit Promise(impl::SharedState<T>* sharedState);
+
     Promise(const Promise& other) = delete;
     Promise& operator=(const Promise& other) = delete;
     Promise(Promise&& other) noexcept;
     Promise& operator=(Promise&& other) noexcept;
     Future<T> getFuture();
     void setException(std::exception_ptr e);
+    // Fails the future without an exception object: get() throws one built
+    // from the code, Future::error() returns the code as is
+    void setError(std::error_code error);
     void setValue(T value);
     ~Promise();
 
 private:
+    void checkUnsatisfied() const;
+    void release();
     void decreaseRefCount();
 
     impl::SharedState<T>* _sharedState;
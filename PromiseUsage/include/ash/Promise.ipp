@@ -1,11 +1,22 @@
 #pragma once
 #include <future>
+#include <utility>
 
 namespace ash {
 template<class T>
-Promise<T>::Promise() : _sharedState(new impl::SharedState<T>)
-                      , _futureRetrieved(false)
-                      , _valueSet(false)
+Promise<T>::Promise() : Promise(std::allocator_arg, PoolAllocator<T>())
+{}
+
+template<class T>
+template<class Allocator>
+Promise<T>::Promise(std::allocator_arg_t, const Allocator& allocator)
+    : Promise(impl::AllocatedSharedState<T, Allocator>::create(allocator))
+{}
+
+template<class T>
+Promise<T>::Promise(impl::SharedState<T>* sharedState) : _sharedState(sharedState)
+                                                       , _futureRetrieved(false)
+                                                       , _valueSet(false)
 {}
 
 template<class T>
@@ -24,7 +35,7 @@ Promise<T>& Promise<T>::operator=(Promise&& other) noexcept
     {
         if (_sharedState)
         {
-            decreaseRefCount();
+            release();
         }
         _sharedState = other._sharedState;
         _futureRetrieved = other._futureRetrieved;
@@ -48,21 +59,41 @@ Future<T> Promise<T>::getFuture()
 template<class T>
 void Promise<T>::setException(std::exception_ptr e)
 {
-    if (!_sharedState)
-    {
-        throw std::future_error(std::future_errc::no_state);
-    }
-    if (_valueSet)
-    {
-        throw std::future_error(std::future_errc::promise_already_satisfied);
-    }
+    checkUnsatisfied();
+    _valueSet = true;
+    new(&_sharedState->exception) std::exception_ptr(std::move(e));
+    _sharedState->setReady(impl::SharedState<T>::HAS_EXCEPTION);
+}
+
+template<class T>
+void Promise<T>::setError(std::error_code error)
+{
+    checkUnsatisfied();
     _valueSet = true;
-    _sharedState->exception = std::move(e);
-    _sharedState->ready.store(true, std::memory_order_release);
+    new(&_sharedState->error) std::error_code(error);
+    _sharedState->setReady(impl::SharedState<T>::HAS_ERROR);
 }
 
 template<class T>
 void Promise<T>::setValue(T value)
+{
+    checkUnsatisfied();
+    _valueSet = true;
+    new(&_sharedState->value) T(std::move(value));
+    _sharedState->setReady(impl::SharedState<T>::HAS_VALUE);
+}
+
+template<class T>
+Promise<T>::~Promise()
+{
+    if (_sharedState)
+    {
+        release();
+    }
+}
+
+template<class T>
+void Promise<T>::checkUnsatisfied() const
 {
     if (!_sharedState)
     {
@@ -72,31 +103,26 @@ void Promise<T>::setValue(T value)
     {
         throw std::future_error(std::future_errc::promise_already_satisfied);
     }
-    _valueSet = true;
-    new(&_sharedState->value) T(std::move(value));
-    _sharedState->ready.store(true, std::memory_order_release);
 }
 
 template<class T>
-Promise<T>::~Promise()
+void Promise<T>::release()
 {
-    if (_sharedState)
+    // Waiters and continuations must not be left hanging. Dropping many
+    // promises at once, e.g. when a Module shuts down, must stay cheap, so
+    // this sets an error code and no exception is created unless the future
+    // is read with get().
+    if (!_valueSet)
     {
-        if (!_valueSet)
-        {
-            _sharedState->exception = std::make_exception_ptr(std::future_error(std::future_errc::broken_promise));
-            _sharedState->ready.store(true, std::memory_order_release);
-        }
-        decreaseRefCount();
+        new(&_sharedState->error) std::error_code(std::make_error_code(std::future_errc::broken_promise));
+        _sharedState->setReady(impl::SharedState<T>::HAS_ERROR);
     }
+    decreaseRefCount();
 }
 
 template<class T>
 void Promise<T>::decreaseRefCount()
 {
-    if (_sharedState->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
-    {
-        delete _sharedState;
-    }
+    std::exchange(_sharedState, nullptr)->decreaseRefCount();
 }
 }
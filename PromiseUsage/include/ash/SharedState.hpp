@@ -1,20 +1,83 @@
 #pragma once
 
 #include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <system_error>
+
+#include "Callback.hpp"
 
 namespace ash::impl {
 template<class T>
 struct alignas(64) SharedState
 {
-    alignas(alignof(T)) char value[sizeof(T)];
-    std::exception_ptr exception;
-    std::atomic_bool ready;
+    // Bits of status
+    static constexpr uint32_t READY = 1;
+    static constexpr uint32_t WAITING = 2;        // a thread sleeps in wait()
+    static constexpr uint32_t CONTINUATION = 4;   // continuation is set
+    // Which member of the union is set, published along with READY
+    static constexpr uint32_t HAS_VALUE = 8;
+    static constexpr uint32_t HAS_ERROR = 16;
+    static constexpr uint32_t HAS_EXCEPTION = 32;
+    static constexpr uint32_t RESULT_MASK = HAS_VALUE | HAS_ERROR | HAS_EXCEPTION;
+
+    // Frees the state once the last reference is gone
+    using Deleter = void (*)(SharedState* state);
+
+    // An error code is enough for broken promises and cancellation, so the
+    // exception_ptr, and the exception object behind it, only exist when an
+    // exception is set
+    union
+    {
+        T value;
+        std::error_code error;
+        std::exception_ptr exception;
+    };
+    std::atomic<uint32_t> status;
     std::atomic_int refCount;
+    Callback continuation;
+    Deleter deleter;
 
-    SharedState();
+    explicit SharedState(Deleter deleter = &deleteState);
     ~SharedState();
+
+    static void deleteState(SharedState* state);
+    void decreaseRefCount();
+
+    bool isReady() const;
+    // One of the HAS_ bits once ready
+    uint32_t result() const;
+    // Publishes the member of the union that was just constructed, wakes the
+    // waiters and runs the continuation
+    void setReady(uint32_t result);
+    void wait();
+    // Runs the continuation right away if the state is already ready
+    void setContinuation(Callback callback);
+    // Takes back a continuation that is no longer wanted, so that another one
+    // can be set: drops it if the state is not ready yet, otherwise waits
+    // until setReady() has moved it out to run it
+    void detachContinuation();
+
+private:
+    void runContinuation();
+};
+
+// Throws the exception get() reports for an error code: future_error for the
+// future category, system_error otherwise
+[[noreturn]] void throwError(const std::error_code& error);
+
+// State allocated with, and freed through, a copy of the promise's allocator
+template<class T, class Allocator>
+struct AllocatedSharedState : SharedState<T>
+{
+    explicit AllocatedSharedState(const Allocator& allocator);
+
+    static AllocatedSharedState* create(const Allocator& allocator);
+    static void destroy(SharedState<T>* state);
+
+    Allocator allocator;
 };
 }
 
 #include "SharedState.ipp"
-
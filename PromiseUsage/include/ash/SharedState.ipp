@@ -1,19 +1,172 @@
 #pragma once
+#include <future>
+#include <system_error>
+#include <thread>
 
 namespace ash::impl {
 template<class T>
-SharedState<T>::SharedState() : value{0}
-                              , ready(false)
-                              , refCount(1)
+SharedState<T>::SharedState(Deleter deleter) : status(0)
+                                             , refCount(1)
+                                             , deleter(deleter)
 {}
 
 template<class T>
 SharedState<T>::~SharedState()
 {
-    if (ready.load(std::memory_order_acquire) && !exception)
+    switch (result())
     {
-        std::launder(reinterpret_cast<T*>(&value))->~T();
+    case HAS_VALUE:
+        value.~T();
+        break;
+    case HAS_EXCEPTION:
+        exception.~exception_ptr();
+        break;
+    default:
+        break;
     }
 }
+
+template<class T>
+void SharedState<T>::deleteState(SharedState* state)
+{
+    delete state;
+}
+
+template<class T>
+void SharedState<T>::decreaseRefCount()
+{
+    if (refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        deleter(this);
+    }
+}
+
+template<class T>
+bool SharedState<T>::isReady() const
+{
+    return status.load(std::memory_order_acquire) & READY;
+}
+
+template<class T>
+uint32_t SharedState<T>::result() const
+{
+    return status.load(std::memory_order_acquire) & RESULT_MASK;
+}
+
+template<class T>
+void SharedState<T>::setReady(uint32_t result)
+{
+    auto old = status.fetch_or(READY | result, std::memory_order_acq_rel);
+    if (old & WAITING)
+    {
+        status.notify_all();
+    }
+    // Whichever of setReady() and setContinuation() comes second runs it
+    if (old & CONTINUATION)
+    {
+        runContinuation();
+    }
+}
+
+template<class T>
+void SharedState<T>::wait()
+{
+    auto current = status.load(std::memory_order_acquire);
+    while (!(current & READY))
+    {
+        if (!(current & WAITING))
+        {
+            if (!status.compare_exchange_weak(current, current | WAITING, std::memory_order_acquire))
+            {
+                continue;
+            }
+            current |= WAITING;
+        }
+        status.wait(current, std::memory_order_relaxed);
+        current = status.load(std::memory_order_acquire);
+    }
+}
+
+template<class T>
+void SharedState<T>::setContinuation(Callback callback)
+{
+    continuation = std::move(callback);
+    // seq_cst so that whenAny() sees either the continuation or its own flag
+    if (status.fetch_or(CONTINUATION, std::memory_order_seq_cst) & READY)
+    {
+        runContinuation();
+    }
+}
+
+template<class T>
+void SharedState<T>::detachContinuation()
+{
+    auto current = status.load(std::memory_order_seq_cst);
+    while (current & CONTINUATION)
+    {
+        if (current & READY)
+        {
+            // setReady() clears CONTINUATION once it has moved it out
+            std::this_thread::yield();
+            current = status.load(std::memory_order_acquire);
+        }
+        else if (status.compare_exchange_weak(current, current & ~CONTINUATION, std::memory_order_acquire))
+        {
+            continuation = Callback();
+            return;
+        }
+    }
+}
+
+template<class T>
+void SharedState<T>::runContinuation()
+{
+    // The continuation may own the last reference to this state, so it is
+    // moved out and nothing is touched after it runs
+    auto callback = std::move(continuation);
+    status.fetch_and(~CONTINUATION, std::memory_order_release);
+    callback();
+}
+
+inline void throwError(const std::error_code& error)
+{
+    if (error.category() == std::future_category())
+    {
+        throw std::future_error(static_cast<std::future_errc>(error.value()));
+    }
+    throw std::system_error(error);
+}
+
+template<class T, class Allocator>
+AllocatedSharedState<T, Allocator>::AllocatedSharedState(const Allocator& allocator)
+    : SharedState<T>(&destroy)
+    , allocator(allocator)
+{}
+
+template<class T, class Allocator>
+AllocatedSharedState<T, Allocator>* AllocatedSharedState<T, Allocator>::create(const Allocator& allocator)
+{
+    using Traits = typename std::allocator_traits<Allocator>::template rebind_traits<AllocatedSharedState>;
+    typename Traits::allocator_type stateAllocator(allocator);
+    auto* state = Traits::allocate(stateAllocator, 1);
+    try
+    {
+        return ::new(static_cast<void*>(state)) AllocatedSharedState(allocator);
+    }
+    catch (...)
+    {
+        Traits::deallocate(stateAllocator, state, 1);
+        throw;
+    }
 }
 
+template<class T, class Allocator>
+void AllocatedSharedState<T, Allocator>::destroy(SharedState<T>* state)
+{
+    using Traits = typename std::allocator_traits<Allocator>::template rebind_traits<AllocatedSharedState>;
+    auto* self = static_cast<AllocatedSharedState*>(state);
+    typename Traits::allocator_type stateAllocator(self->allocator);
+    self->~AllocatedSharedState();
+    Traits::deallocate(stateAllocator, self, 1);
+}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "BlockingQueue.hpp"
+
+namespace ash {
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread (Lamport's ring buffer). Each side owns one index and keeps a cached
+// copy of the other side's index, so the shared cache lines are only read
+// when the cached value says the queue looks full (producer) or empty
+// (consumer). The capacity is the requested size rounded up to a power of two.
+template<class T>
+class SpscQueue : public impl::BlockingQueue<SpscQueue<T>, T>
+{
+public:
+    explicit SpscQueue(size_t size);
+    SpscQueue(const SpscQueue& other) = delete;
+    SpscQueue& operator=(const SpscQueue& other) = delete;
+    ~SpscQueue();
+
+    size_t capacity() const;
+
+private:
+    friend impl::BlockingQueue<SpscQueue<T>, T>;
+
+    struct Slot
+    {
+        alignas(alignof(T)) unsigned char storage[sizeof(T)];
+    };
+
+    template<class U>
+    bool doTryPush(U&& value);
+    std::optional<T> doTryPop();
+    T* slot(size_t index);
+
+    size_t _mask;
+    std::unique_ptr<Slot[]> _slots;
+
+    // Consumer side
+    alignas(impl::CACHE_LINE_SIZE) std::atomic<size_t> _head;
+    size_t _cachedTail;
+
+    // Producer side
+    alignas(impl::CACHE_LINE_SIZE) std::atomic<size_t> _tail;
+    size_t _cachedHead;
+};
+}
+
+#include "SpscQueue.ipp"
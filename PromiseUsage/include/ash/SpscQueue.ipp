@@ -0,0 +1,73 @@
+#pragma once
+
+#include <new>
+
+namespace ash {
+template<class T>
+SpscQueue<T>::SpscQueue(size_t size) : _mask(impl::roundUpToPowerOfTwo(size) - 1)
+                                     , _slots(new Slot[_mask + 1])
+                                     , _head(0)
+                                     , _cachedTail(0)
+                                     , _tail(0)
+                                     , _cachedHead(0)
+{}
+
+template<class T>
+SpscQueue<T>::~SpscQueue()
+{
+    size_t tail = _tail.load(std::memory_order_acquire);
+    for (size_t head = _head.load(std::memory_order_relaxed); head != tail; ++head)
+    {
+        slot(head)->~T();
+    }
+}
+
+template<class T>
+size_t SpscQueue<T>::capacity() const
+{
+    return _mask + 1;
+}
+
+template<class T>
+template<class U>
+bool SpscQueue<T>::doTryPush(U&& value)
+{
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _cachedHead == capacity())
+    {
+        _cachedHead = _head.load(std::memory_order_acquire);
+        if (tail - _cachedHead == capacity())
+        {
+            return false;
+        }
+    }
+    new(slot(tail)) T(std::forward<U>(value));
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+template<class T>
+std::optional<T> SpscQueue<T>::doTryPop()
+{
+    size_t head = _head.load(std::memory_order_relaxed);
+    if (head == _cachedTail)
+    {
+        _cachedTail = _tail.load(std::memory_order_acquire);
+        if (head == _cachedTail)
+        {
+            return {};
+        }
+    }
+    T* element = slot(head);
+    std::optional<T> value(std::move(*element));
+    element->~T();
+    _head.store(head + 1, std::memory_order_release);
+    return value;
+}
+
+template<class T>
+T* SpscQueue<T>::slot(size_t index)
+{
+    return std::launder(reinterpret_cast<T*>(_slots[index & _mask].storage));
+}
+}
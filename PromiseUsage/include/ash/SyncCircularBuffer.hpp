@@ -2,6 +2,7 @@
 
 #include <chrono>
 #include <condition_variable>
+#include <cstddef>
 #include <mutex>
 #include <optional>
 #include <boost/circular_buffer.hpp>
@@ -22,23 +23,63 @@ public:
     template<class U>
     bool tryPush(U&& value);
 
+    // Constructs the value from args under the lock, waiting for room as push() does.
+    template<class... Args>
+    bool emplace(Args&&... args);
+
+    // Pushes [first, last) taking the lock once per run of values that fits in
+    // the buffer and waking the consumers once per run rather than once per
+    // value. Returns the number of values pushed, which is less than
+    // distance(first, last) only if timeoutMs expired while the buffer was full.
+    // Pass move iterators to move the values in.
+    template<class InputIt>
+    size_t pushBulk(InputIt first, InputIt last, std::chrono::milliseconds timeoutMs);
+
+    template<class InputIt>
+    size_t pushBulk(InputIt first, InputIt last);
+
     std::optional<T> pop(std::chrono::milliseconds timeoutMs);
     std::optional<T> pop();
     std::optional<T> tryPop();
 
+    // Moves up to maxCount values into values[0, maxCount), waiting up to
+    // timeoutMs for at least one. Returns the number of values moved.
+    size_t popInto(T* values, size_t maxCount, std::chrono::milliseconds timeoutMs);
+    size_t popInto(T* values, size_t maxCount);
+    size_t tryPopInto(T* values, size_t maxCount);
+
+    // Calls fn(T* first, T* last) on the at most two contiguous segments holding
+    // the first min(maxCount, size) values, then removes them. fn runs under the
+    // lock and should only move the values out. Does not wait; returns the
+    // number of values consumed.
+    template<class F>
+    size_t consume(size_t maxCount, F&& fn);
+
     template<class Collection>
     void popAll(Collection& values);
 
 private:
     T doPop();
+    template<class F>
+    size_t doConsume(size_t maxCount, F&& fn);
+    template<class Predicate>
+    bool waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& cv, size_t& waiters,
+                   std::chrono::milliseconds timeoutMs, Predicate predicate);
+    template<class Predicate>
+    bool waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& cv, size_t& waiters,
+                   std::chrono::steady_clock::time_point deadline, Predicate predicate);
+    static std::chrono::steady_clock::time_point deadlineAfter(std::chrono::milliseconds timeoutMs);
+    static void notify(std::condition_variable& cv, size_t waiters, size_t count);
 
     static constexpr auto MAX_WAIT_MS = std::chrono::milliseconds::max();
     mutable std::mutex _mutex;
     std::condition_variable _cvFull;
     std::condition_variable _cvEmpty;
+    // Threads blocked on _cvFull/_cvEmpty, so that nobody is notified when nobody waits
+    size_t _pushWaiters = 0;
+    size_t _popWaiters = 0;
     boost::circular_buffer<T> _buffer;
 };
 }
 
 #include "SyncCircularBuffer.ipp"
-
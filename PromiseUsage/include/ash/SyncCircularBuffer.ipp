@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <iterator>
+
 namespace ash {
 template<class T>
 SyncCircularBuffer<T>::SyncCircularBuffer(size_t size) : _buffer(size)
@@ -11,14 +14,12 @@ bool SyncCircularBuffer<T>::push(U&& value, std::chrono::milliseconds timeoutMs)
 {
     static_assert(std::is_constructible_v<T, U&&>, "Can't construct: incompatible types or non-copyable class");
     std::unique_lock lock(_mutex);
-    auto deadline = timeoutMs == MAX_WAIT_MS ?
-                        std::chrono::steady_clock::time_point::max() :
-                        std::chrono::steady_clock::now() + timeoutMs;
-    if (_cvFull.wait_until(lock, deadline, [this]() { return !_buffer.full(); }))
+    if (waitUntil(lock, _cvFull, _pushWaiters, timeoutMs, [this]() { return !_buffer.full(); }))
     {
         _buffer.push_back(std::forward<U>(value));
+        auto waiters = _popWaiters;
         lock.unlock();
-        _cvEmpty.notify_one();
+        notify(_cvEmpty, waiters, 1);
         return true;
     }
     return false;
@@ -41,27 +42,83 @@ bool SyncCircularBuffer<T>::tryPush(U&& value)
         if (!_buffer.full())
         {
             _buffer.push_back(std::forward<U>(value));
+            auto waiters = _popWaiters;
             lock.unlock();
-            _cvEmpty.notify_one();
+            notify(_cvEmpty, waiters, 1);
             return true;
         }
     }
     return false;
 }
 
+template<class T>
+template<class... Args>
+bool SyncCircularBuffer<T>::emplace(Args&&... args)
+{
+    static_assert(std::is_constructible_v<T, Args&&...>, "Can't construct: incompatible types or non-copyable class");
+    std::unique_lock lock(_mutex);
+    waitUntil(lock, _cvFull, _pushWaiters, MAX_WAIT_MS, [this]() { return !_buffer.full(); });
+    // boost::circular_buffer has no emplace_back: the temporary is moved
+    // straight into the free slot
+    _buffer.push_back(T(std::forward<Args>(args)...));
+    auto waiters = _popWaiters;
+    lock.unlock();
+    notify(_cvEmpty, waiters, 1);
+    return true;
+}
+
+template<class T>
+template<class InputIt>
+size_t SyncCircularBuffer<T>::pushBulk(InputIt first, InputIt last, std::chrono::milliseconds timeoutMs)
+{
+    size_t pushed = 0;
+    size_t run = 0;
+    // The timeout bounds the whole call, not each wait for room
+    auto deadline = deadlineAfter(timeoutMs);
+    std::unique_lock lock(_mutex);
+    while (first != last)
+    {
+        if (_buffer.full())
+        {
+            // Let the consumers drain this run before waiting for room
+            notify(_cvEmpty, _popWaiters, run);
+            run = 0;
+            if (!waitUntil(lock, _cvFull, _pushWaiters, deadline, [this]() { return !_buffer.full(); }))
+            {
+                break;
+            }
+        }
+        for (; first != last && !_buffer.full(); ++first)
+        {
+            _buffer.push_back(*first);
+            ++run;
+            ++pushed;
+        }
+    }
+    auto waiters = _popWaiters;
+    lock.unlock();
+    notify(_cvEmpty, waiters, run);
+    return pushed;
+}
+
+template<class T>
+template<class InputIt>
+size_t SyncCircularBuffer<T>::pushBulk(InputIt first, InputIt last)
+{
+    return pushBulk(first, last, MAX_WAIT_MS);
+}
+
 template<class T>
 std::optional<T> SyncCircularBuffer<T>::pop(std::chrono::milliseconds timeoutMs)
 {
     std::unique_lock lock(_mutex);
-    auto deadline = timeoutMs == MAX_WAIT_MS ?
-                        std::chrono::steady_clock::time_point::max() :
-                        std::chrono::steady_clock::now() + timeoutMs;
     std::optional<T> value;
-    if (_cvEmpty.wait_until(lock, deadline, [this]() { return !_buffer.empty(); }))
+    if (waitUntil(lock, _cvEmpty, _popWaiters, timeoutMs, [this]() { return !_buffer.empty(); }))
     {
         value = doPop();
+        auto waiters = _pushWaiters;
         lock.unlock();
-        _cvFull.notify_one();
+        notify(_cvFull, waiters, 1);
     }
     return value;
 }
@@ -81,24 +138,68 @@ std::optional<T> SyncCircularBuffer<T>::tryPop()
         if (!_buffer.empty())
         {
             value = doPop();
+            auto waiters = _pushWaiters;
             lock.unlock();
-            _cvFull.notify_one();
+            notify(_cvFull, waiters, 1);
         }
     }
     return value;
 }
 
 template<class T>
-template<class Collection>
-void SyncCircularBuffer<T>::popAll(Collection& values)
+size_t SyncCircularBuffer<T>::popInto(T* values, size_t maxCount, std::chrono::milliseconds timeoutMs)
 {
     std::unique_lock lock(_mutex);
-    while (!_buffer.empty())
+    size_t count = 0;
+    if (maxCount > 0 && waitUntil(lock, _cvEmpty, _popWaiters, timeoutMs, [this]() { return !_buffer.empty(); }))
+    {
+        count = doConsume(maxCount, [&values](T* first, T* last) { values = std::move(first, last, values); });
+        auto waiters = _pushWaiters;
+        lock.unlock();
+        notify(_cvFull, waiters, count);
+    }
+    return count;
+}
+
+template<class T>
+size_t SyncCircularBuffer<T>::popInto(T* values, size_t maxCount)
+{
+    return popInto(values, maxCount, MAX_WAIT_MS);
+}
+
+template<class T>
+size_t SyncCircularBuffer<T>::tryPopInto(T* values, size_t maxCount)
+{
+    size_t count = 0;
+    if (auto lock = std::unique_lock(_mutex, std::try_to_lock))
     {
-        values.push_back(doPop());
+        count = doConsume(maxCount, [&values](T* first, T* last) { values = std::move(first, last, values); });
+        auto waiters = _pushWaiters;
+        lock.unlock();
+        notify(_cvFull, waiters, count);
     }
+    return count;
+}
+
+template<class T>
+template<class F>
+size_t SyncCircularBuffer<T>::consume(size_t maxCount, F&& fn)
+{
+    std::unique_lock lock(_mutex);
+    auto count = doConsume(maxCount, std::forward<F>(fn));
+    auto waiters = _pushWaiters;
     lock.unlock();
-    _cvFull.notify_one();
+    notify(_cvFull, waiters, count);
+    return count;
+}
+
+template<class T>
+template<class Collection>
+void SyncCircularBuffer<T>::popAll(Collection& values)
+{
+    consume(_buffer.capacity(), [&values](T* first, T* last) {
+        values.insert(values.end(), std::make_move_iterator(first), std::make_move_iterator(last));
+    });
 }
 
 template<class T>
@@ -108,4 +209,75 @@ T SyncCircularBuffer<T>::doPop()
     _buffer.pop_front();
     return value;
 }
+
+template<class T>
+template<class F>
+size_t SyncCircularBuffer<T>::doConsume(size_t maxCount, F&& fn)
+{
+    auto count = std::min(maxCount, _buffer.size());
+    if (count == 0)
+    {
+        return 0;
+    }
+    auto one = _buffer.array_one();
+    auto countOne = std::min(count, one.second);
+    fn(one.first, one.first + countOne);
+    if (countOne < count)
+    {
+        auto two = _buffer.array_two();
+        fn(two.first, two.first + (count - countOne));
+    }
+    _buffer.erase_begin(count);
+    return count;
+}
+
+template<class T>
+template<class Predicate>
+bool SyncCircularBuffer<T>::waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& cv,
+                                      size_t& waiters, std::chrono::milliseconds timeoutMs, Predicate predicate)
+{
+    // The clock is only read once a wait is needed
+    return predicate() || waitUntil(lock, cv, waiters, deadlineAfter(timeoutMs), predicate);
+}
+
+template<class T>
+template<class Predicate>
+bool SyncCircularBuffer<T>::waitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& cv,
+                                      size_t& waiters, std::chrono::steady_clock::time_point deadline,
+                                      Predicate predicate)
+{
+    if (predicate())
+    {
+        return true;
+    }
+    ++waiters;
+    auto ready = cv.wait_until(lock, deadline, predicate);
+    --waiters;
+    return ready;
+}
+
+template<class T>
+std::chrono::steady_clock::time_point SyncCircularBuffer<T>::deadlineAfter(std::chrono::milliseconds timeoutMs)
+{
+    return timeoutMs == MAX_WAIT_MS ?
+               std::chrono::steady_clock::time_point::max() :
+               std::chrono::steady_clock::now() + timeoutMs;
+}
+
+template<class T>
+void SyncCircularBuffer<T>::notify(std::condition_variable& cv, size_t waiters, size_t count)
+{
+    if (waiters == 0 || count == 0)
+    {
+        return;
+    }
+    if (count == 1)
+    {
+        cv.notify_one();
+    }
+    else
+    {
+        cv.notify_all();
+    }
+}
 }
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+
+namespace ash {
+template<class T = void>
+class Task;
+
+namespace impl {
+template<class T>
+class TaskPromiseBase
+{
+public:
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept;
+        template<class Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept;
+        void await_resume() const noexcept;
+    };
+
+    std::suspend_always initial_suspend() const noexcept;
+    FinalAwaiter final_suspend() const noexcept;
+    void unhandled_exception();
+    void setContinuation(std::coroutine_handle<> continuation);
+
+protected:
+    void rethrowIfFailed();
+
+private:
+    std::coroutine_handle<> _continuation;
+    std::exception_ptr _exception;
+};
+
+template<class T>
+class TaskPromise : public TaskPromiseBase<T>
+{
+public:
+    Task<T> get_return_object();
+    template<class U>
+    void return_value(U&& value);
+    T result();
+
+private:
+    std::optional<T> _value;
+};
+
+template<>
+class TaskPromise<void> : public TaskPromiseBase<void>
+{
+public:
+    Task<void> get_return_object();
+    void return_void() const;
+    void result();
+};
+}
+
+// Lazily started coroutine: its body runs when the task is awaited, on the
+// awaiting thread, and the awaiting coroutine is resumed right where the task
+// completes. Run top-level tasks with EventLoop::spawn().
+template<class T>
+class Task
+{
+public:
+    using promise_type = impl::TaskPromise<T>;
+
+    class Awaiter
+    {
+    public:
+        explicit Awaiter(std::coroutine_handle<promise_type> handle);
+        bool await_ready() const;
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting);
+        T await_resume();
+
+    private:
+        std::coroutine_handle<promise_type> _handle;
+    };
+
+    Task(const Task& other) = delete;
+    Task& operator=(const Task& other) = delete;
+    Task(Task&& other) noexcept;
+    Task& operator=(Task&& other) noexcept;
+    Awaiter operator co_await() &&;
+    ~Task();
+
+private:
+    friend promise_type;
+
+    explicit Task(std::coroutine_handle<promise_type> handle);
+
+    std::coroutine_handle<promise_type> _handle;
+};
+}
+
+#include "Task.ipp"
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <future>
+#include <utility>
+
+namespace ash {
+namespace impl {
+template<class T>
+bool TaskPromiseBase<T>::FinalAwaiter::await_ready() const noexcept
+{
+    return false;
+}
+
+template<class T>
+template<class Promise>
+std::coroutine_handle<> TaskPromiseBase<T>::FinalAwaiter::await_suspend(std::coroutine_handle<Promise> handle) noexcept
+{
+    // Symmetric transfer back to the awaiting coroutine
+    auto continuation = handle.promise()._continuation;
+    return continuation ? continuation : std::noop_coroutine();
+}
+
+template<class T>
+void TaskPromiseBase<T>::FinalAwaiter::await_resume() const noexcept
+{}
+
+template<class T>
+std::suspend_always TaskPromiseBase<T>::initial_suspend() const noexcept
+{
+    return {};
+}
+
+template<class T>
+typename TaskPromiseBase<T>::FinalAwaiter TaskPromiseBase<T>::final_suspend() const noexcept
+{
+    return {};
+}
+
+template<class T>
+void TaskPromiseBase<T>::unhandled_exception()
+{
+    _exception = std::current_exception();
+}
+
+template<class T>
+void TaskPromiseBase<T>::setContinuation(std::coroutine_handle<> continuation)
+{
+    _continuation = continuation;
+}
+
+template<class T>
+void TaskPromiseBase<T>::rethrowIfFailed()
+{
+    if (_exception)
+    {
+        std::rethrow_exception(_exception);
+    }
+}
+
+template<class T>
+Task<T> TaskPromise<T>::get_return_object()
+{
+    return Task<T>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+}
+
+template<class T>
+template<class U>
+void TaskPromise<T>::return_value(U&& value)
+{
+    _value.emplace(std::forward<U>(value));
+}
+
+template<class T>
+T TaskPromise<T>::result()
+{
+    this->rethrowIfFailed();
+    return std::move(*_value);
+}
+
+inline Task<void> TaskPromise<void>::get_return_object()
+{
+    return Task<void>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+}
+
+inline void TaskPromise<void>::return_void() const
+{}
+
+inline void TaskPromise<void>::result()
+{
+    rethrowIfFailed();
+}
+}
+
+template<class T>
+Task<T>::Awaiter::Awaiter(std::coroutine_handle<promise_type> handle) : _handle(handle)
+{}
+
+template<class T>
+bool Task<T>::Awaiter::await_ready() const
+{
+    return !_handle || _handle.done();
+}
+
+template<class T>
+std::coroutine_handle<> Task<T>::Awaiter::await_suspend(std::coroutine_handle<> awaiting)
+{
+    _handle.promise().setContinuation(awaiting);
+    return _handle;
+}
+
+template<class T>
+T Task<T>::Awaiter::await_resume()
+{
+    if (!_handle)
+    {
+        throw std::future_error(std::future_errc::no_state);
+    }
+    return _handle.promise().result();
+}
+
+template<class T>
+Task<T>::Task(Task&& other) noexcept : _handle(std::exchange(other._handle, nullptr))
+{}
+
+template<class T>
+Task<T>& Task<T>::operator=(Task&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (_handle)
+        {
+            _handle.destroy();
+        }
+        _handle = std::exchange(other._handle, nullptr);
+    }
+    return *this;
+}
+
+template<class T>
+typename Task<T>::Awaiter Task<T>::operator co_await() &&
+{
+    return Awaiter(_handle);
+}
+
+template<class T>
+Task<T>::~Task()
+{
+    if (_handle)
+    {
+        _handle.destroy();
+    }
+}
+
+template<class T>
+Task<T>::Task(std::coroutine_handle<promise_type> handle) : _handle(handle)
+{}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "EventCount.hpp"
+#include "Executor.hpp"
+#include "WorkStealingDeque.hpp"
+
+namespace ash {
+enum class Priority
+{
+    LATENCY_CRITICAL,
+    BATCH
+};
+
+// Fixed set of worker threads running callbacks, with one lane per priority.
+// Each worker has a deque per lane: callbacks posted from a worker go to its
+// own deque, where it takes them back newest first while idle workers steal
+// them oldest first; callbacks posted from other threads go to a shared queue
+// per lane. Workers always look for latency-critical callbacks first, so
+// batch callbacks only run on threads the latency-critical lane leaves idle,
+// although a batch callback that has started is never interrupted.
+//
+// As an Executor, the pool posts to the latency-critical lane, and coroutines
+// running on a worker are resumed on that lane. A callback must not throw.
+class ThreadPool : public Executor
+{
+public:
+    // 0 threads means one per hardware thread. With pinThreads, worker i is
+    // bound to the i-th CPU, modulo their number, of those the calling thread
+    // is allowed to run on (Linux only, ignored elsewhere). Throws
+    // std::system_error if the CPUs cannot be read or a worker cannot be bound.
+    explicit ThreadPool(std::size_t numberOfThreads = 0, bool pinThreads = false);
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+    // Runs the callbacks already posted, and those they post, then joins the workers
+    ~ThreadPool() override;
+
+    // Thread-safe
+    void execute(Callback callback) override;
+    void execute(Callback callback, Priority priority);
+
+    // Executor posting to one lane, e.g. for async() or Future::then()
+    Executor& lane(Priority priority);
+
+    std::size_t size() const;
+
+private:
+    static constexpr std::size_t LANE_COUNT = 2;
+
+    class Lane : public Executor
+    {
+    public:
+        Lane(ThreadPool& pool, Priority priority);
+        void execute(Callback callback) override;
+
+    private:
+        ThreadPool& _pool;
+        Priority _priority;
+    };
+
+    struct Worker
+    {
+        Worker(ThreadPool& pool, std::size_t index);
+
+        ThreadPool& pool;
+        std::size_t index;
+        std::thread thread;
+        impl::WorkStealingDeque<Callback*> deques[LANE_COUNT];
+    };
+
+    // Callbacks posted from outside of the pool
+    struct SharedQueue
+    {
+        std::mutex mutex;
+        std::deque<Callback*> callbacks;
+        // Lets workers skip the lock while the queue is empty
+        std::atomic<std::size_t> size{0};
+    };
+
+    static Worker*& currentWorker();
+    static Callback* allocate(Callback callback);
+    static void runAndFree(Callback* callback);
+    static std::vector<int> allowedCpus();
+    static void pin(std::thread& thread, int cpu);
+
+    // Stops and joins the workers started so far
+    void stop();
+
+    void run(Worker& worker);
+    Callback* findWork(Worker& worker);
+    Callback* takeShared(std::size_t lane);
+    Callback* steal(const Worker& thief, std::size_t lane);
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    SharedQueue _shared[LANE_COUNT];
+    Lane _latencyCriticalLane;
+    Lane _batchLane;
+    impl::EventCount _workAvailable;
+    std::atomic_bool _stopping;
+};
+}
+
+#include "ThreadPool.ipp"
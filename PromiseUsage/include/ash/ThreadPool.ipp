@@ -0,0 +1,259 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <memory>
+#include <system_error>
+#include <utility>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "PoolAllocator.hpp"
+
+namespace ash {
+inline ThreadPool::Lane::Lane(ThreadPool& pool, Priority priority) : _pool(pool)
+                                                                   , _priority(priority)
+{}
+
+inline void ThreadPool::Lane::execute(Callback callback)
+{
+    _pool.execute(std::move(callback), _priority);
+}
+
+inline ThreadPool::Worker::Worker(ThreadPool& pool, std::size_t index) : pool(pool)
+                                                                       , index(index)
+{}
+
+inline ThreadPool::ThreadPool(std::size_t numberOfThreads, bool pinThreads)
+    : _latencyCriticalLane(*this, Priority::LATENCY_CRITICAL)
+    , _batchLane(*this, Priority::BATCH)
+    , _stopping(false)
+{
+    if (numberOfThreads == 0)
+    {
+        numberOfThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::vector<int> cpus;
+    if (pinThreads)
+    {
+        cpus = allowedCpus();
+    }
+    for (std::size_t i = 0; i < numberOfThreads; ++i)
+    {
+        _workers.push_back(std::make_unique<Worker>(*this, i));
+    }
+    // Started once all the deques exist, since workers steal from each other.
+    // The destructor does not run if the constructor throws, so the workers
+    // already started are joined here.
+    try
+    {
+        for (auto& worker : _workers)
+        {
+            worker->thread = std::thread(&ThreadPool::run, this, std::ref(*worker));
+            if (!cpus.empty())
+            {
+                pin(worker->thread, cpus[worker->index % cpus.size()]);
+            }
+        }
+    }
+    catch (...)
+    {
+        stop();
+        throw;
+    }
+}
+
+inline ThreadPool::~ThreadPool()
+{
+    stop();
+}
+
+inline void ThreadPool::stop()
+{
+    _stopping.store(true, std::memory_order_release);
+    _workAvailable.notifyAll();
+    for (auto& worker : _workers)
+    {
+        if (worker->thread.joinable())
+        {
+            worker->thread.join();
+        }
+    }
+}
+
+inline void ThreadPool::execute(Callback callback)
+{
+    execute(std::move(callback), Priority::LATENCY_CRITICAL);
+}
+
+inline void ThreadPool::execute(Callback callback, Priority priority)
+{
+    auto lane = static_cast<std::size_t>(priority);
+    auto* worker = currentWorker();
+    if (worker && &worker->pool == this)
+    {
+        worker->deques[lane].push(allocate(std::move(callback)));
+    }
+    else
+    {
+        auto& shared = _shared[lane];
+        std::lock_guard lock(shared.mutex);
+        shared.callbacks.push_back(allocate(std::move(callback)));
+        shared.size.store(shared.callbacks.size(), std::memory_order_relaxed);
+    }
+    _workAvailable.notifyAll();
+}
+
+inline Executor& ThreadPool::lane(Priority priority)
+{
+    return priority == Priority::LATENCY_CRITICAL ? static_cast<Executor&>(_latencyCriticalLane) : _batchLane;
+}
+
+inline std::size_t ThreadPool::size() const
+{
+    return _workers.size();
+}
+
+inline ThreadPool::Worker*& ThreadPool::currentWorker()
+{
+    thread_local Worker* worker = nullptr;
+    return worker;
+}
+
+inline Callback* ThreadPool::allocate(Callback callback)
+{
+    PoolAllocator<Callback> allocator;
+    auto* slot = allocator.allocate(1);
+    return ::new(static_cast<void*>(slot)) Callback(std::move(callback));
+}
+
+inline void ThreadPool::runAndFree(Callback* callback)
+{
+    (*callback)();
+    callback->~Callback();
+    PoolAllocator<Callback>().deallocate(callback, 1);
+}
+
+inline std::vector<int> ThreadPool::allowedCpus()
+{
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "sched_getaffinity");
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (CPU_ISSET(cpu, &allowed))
+        {
+            cpus.push_back(cpu);
+        }
+    }
+#endif
+    return cpus;
+}
+
+inline void ThreadPool::pin(std::thread& thread, int cpu)
+{
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    int error = pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+    if (error != 0)
+    {
+        throw std::system_error(error, std::generic_category(), "pthread_setaffinity_np");
+    }
+#else
+    (void)thread;
+    (void)cpu;
+#endif
+}
+
+inline void ThreadPool::run(Worker& worker)
+{
+    currentWorker() = &worker;
+    impl::CurrentExecutorScope scope(this);
+    for (;;)
+    {
+        if (auto* callback = findWork(worker))
+        {
+            runAndFree(callback);
+            continue;
+        }
+        // Looks again once registered as a waiter, so that a callback posted
+        // in between is not missed
+        auto key = _workAvailable.prepareWait();
+        if (auto* callback = findWork(worker))
+        {
+            _workAvailable.cancelWait();
+            runAndFree(callback);
+            continue;
+        }
+        if (_stopping.load(std::memory_order_acquire))
+        {
+            _workAvailable.cancelWait();
+            break;
+        }
+        _workAvailable.waitUntil(key, std::chrono::steady_clock::time_point::max());
+    }
+    currentWorker() = nullptr;
+}
+
+inline Callback* ThreadPool::findWork(Worker& worker)
+{
+    for (std::size_t lane = 0; lane < LANE_COUNT; ++lane)
+    {
+        if (auto callback = worker.deques[lane].pop())
+        {
+            return *callback;
+        }
+        if (auto* callback = takeShared(lane))
+        {
+            return callback;
+        }
+        if (auto* callback = steal(worker, lane))
+        {
+            return callback;
+        }
+    }
+    return nullptr;
+}
+
+inline Callback* ThreadPool::takeShared(std::size_t lane)
+{
+    auto& shared = _shared[lane];
+    if (shared.size.load(std::memory_order_relaxed) == 0)
+    {
+        return nullptr;
+    }
+    std::lock_guard lock(shared.mutex);
+    if (shared.callbacks.empty())
+    {
+        return nullptr;
+    }
+    auto* callback = shared.callbacks.front();
+    shared.callbacks.pop_front();
+    shared.size.store(shared.callbacks.size(), std::memory_order_relaxed);
+    return callback;
+}
+
+inline Callback* ThreadPool::steal(const Worker& thief, std::size_t lane)
+{
+    for (std::size_t i = 1; i < _workers.size(); ++i)
+    {
+        auto& victim = *_workers[(thief.index + i) % _workers.size()];
+        if (auto callback = victim.deques[lane].steal())
+        {
+            return *callback;
+        }
+    }
+    return nullptr;
+}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace ash::impl {
+// Min-heap of values keyed by deadline. 4-ary: half the depth of a binary
+// heap, and the children compared at each level of a sift down share one or
+// two cache lines since the deadlines are stored next to the values.
+template<class T>
+class TimerHeap
+{
+public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    bool empty() const;
+    std::size_t size() const;
+    void push(TimePoint deadline, T value);
+    // Earliest deadline; the heap must not be empty
+    TimePoint nextDeadline() const;
+    // Removes and returns the value with the earliest deadline
+    T pop();
+    // Empties the heap, handing each value to fn in no particular order
+    template<class F>
+    void drain(F&& fn);
+
+private:
+    struct Entry
+    {
+        TimePoint deadline;
+        T value;
+    };
+
+    static constexpr std::size_t ARITY = 4;
+
+    std::vector<Entry> _entries;
+};
+}
+
+#include "TimerHeap.ipp"
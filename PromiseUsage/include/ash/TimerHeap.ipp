@@ -0,0 +1,93 @@
+#pragma once
+
+#include <utility>
+
+namespace ash::impl {
+template<class T>
+bool TimerHeap<T>::empty() const
+{
+    return _entries.empty();
+}
+
+template<class T>
+std::size_t TimerHeap<T>::size() const
+{
+    return _entries.size();
+}
+
+template<class T>
+void TimerHeap<T>::push(TimePoint deadline, T value)
+{
+    Entry entry{deadline, std::move(value)};
+    auto hole = _entries.size();
+    _entries.emplace_back();
+    while (hole > 0)
+    {
+        auto parent = (hole - 1) / ARITY;
+        if (!(deadline < _entries[parent].deadline))
+        {
+            break;
+        }
+        _entries[hole] = std::move(_entries[parent]);
+        hole = parent;
+    }
+    _entries[hole] = std::move(entry);
+}
+
+template<class T>
+typename TimerHeap<T>::TimePoint TimerHeap<T>::nextDeadline() const
+{
+    return _entries.front().deadline;
+}
+
+template<class T>
+T TimerHeap<T>::pop()
+{
+    auto value = std::move(_entries.front().value);
+    auto last = std::move(_entries.back());
+    _entries.pop_back();
+    auto size = _entries.size();
+    if (size == 0)
+    {
+        return value;
+    }
+    std::size_t hole = 0;
+    for (;;)
+    {
+        auto first = hole * ARITY + 1;
+        if (first >= size)
+        {
+            break;
+        }
+        auto end = first + ARITY < size ? first + ARITY : size;
+        auto smallest = first;
+        for (auto child = first + 1; child < end; ++child)
+        {
+            if (_entries[child].deadline < _entries[smallest].deadline)
+            {
+                smallest = child;
+            }
+        }
+        if (!(_entries[smallest].deadline < last.deadline))
+        {
+            break;
+        }
+        _entries[hole] = std::move(_entries[smallest]);
+        hole = smallest;
+    }
+    _entries[hole] = std::move(last);
+    return value;
+}
+
+template<class T>
+template<class F>
+void TimerHeap<T>::drain(F&& fn)
+{
+    auto entries = std::move(_entries);
+    _entries.clear();
+    for (auto& entry : entries)
+    {
+        fn(std::move(entry.value));
+    }
+}
+}
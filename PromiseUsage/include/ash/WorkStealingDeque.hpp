@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "BlockingQueue.hpp"
+
+namespace ash::impl {
+// Chase-Lev deque (with the memory orderings of Le et al., "Correct and
+// Efficient Work-Stealing for Weak Memory Models"). The owning thread pushes
+// and pops at the bottom without contention unless the deque is down to one
+// value; any other thread steals from the top. The array grows as needed;
+// replaced arrays are kept until the deque is destroyed since a thief may
+// still be reading from them.
+template<class T>
+class WorkStealingDeque
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Values are copied through std::atomic<T>");
+
+public:
+    explicit WorkStealingDeque(std::size_t capacity = 256);
+    WorkStealingDeque(const WorkStealingDeque& other) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque& other) = delete;
+
+    // Owner only
+    void push(T value);
+    std::optional<T> pop();
+
+    // Any thread; fails if the deque is empty or another thread won the race for the top value
+    std::optional<T> steal();
+
+    // Snapshot, only exact when called by the owner with no thief around
+    bool empty() const;
+
+private:
+    struct Array
+    {
+        explicit Array(std::size_t capacity);
+        T get(int64_t index) const;
+        void put(int64_t index, T value);
+
+        std::size_t mask;
+        std::unique_ptr<std::atomic<T>[]> slots;
+    };
+
+    Array* grow(Array* array, int64_t top, int64_t bottom);
+
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> _top;
+    alignas(CACHE_LINE_SIZE) std::atomic<int64_t> _bottom;
+    std::atomic<Array*> _array;
+    std::vector<std::unique_ptr<Array>> _arrays;
+};
+}
+
+#include "WorkStealingDeque.ipp"
@@ -0,0 +1,111 @@
+#pragma once
+
+namespace ash::impl {
+template<class T>
+WorkStealingDeque<T>::Array::Array(std::size_t capacity) : mask(capacity - 1)
+                                                         , slots(new std::atomic<T>[capacity])
+{}
+
+template<class T>
+T WorkStealingDeque<T>::Array::get(int64_t index) const
+{
+    return slots[static_cast<std::size_t>(index) & mask].load(std::memory_order_relaxed);
+}
+
+template<class T>
+void WorkStealingDeque<T>::Array::put(int64_t index, T value)
+{
+    slots[static_cast<std::size_t>(index) & mask].store(value, std::memory_order_relaxed);
+}
+
+template<class T>
+WorkStealingDeque<T>::WorkStealingDeque(std::size_t capacity) : _top(0)
+                                                              , _bottom(0)
+{
+    _arrays.push_back(std::make_unique<Array>(roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity)));
+    _array.store(_arrays.back().get(), std::memory_order_relaxed);
+}
+
+template<class T>
+void WorkStealingDeque<T>::push(T value)
+{
+    auto bottom = _bottom.load(std::memory_order_relaxed);
+    auto top = _top.load(std::memory_order_acquire);
+    auto* array = _array.load(std::memory_order_relaxed);
+    if (bottom - top > static_cast<int64_t>(array->mask))
+    {
+        array = grow(array, top, bottom);
+    }
+    array->put(bottom, value);
+    std::atomic_thread_fence(std::memory_order_release);
+    _bottom.store(bottom + 1, std::memory_order_relaxed);
+}
+
+template<class T>
+std::optional<T> WorkStealingDeque<T>::pop()
+{
+    auto bottom = _bottom.load(std::memory_order_relaxed) - 1;
+    auto* array = _array.load(std::memory_order_relaxed);
+    _bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto top = _top.load(std::memory_order_relaxed);
+    std::optional<T> value;
+    if (top <= bottom)
+    {
+        value = array->get(bottom);
+        if (top == bottom)
+        {
+            // Last value: race the thieves for it
+            if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                value.reset();
+            }
+            _bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+    }
+    else
+    {
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return value;
+}
+
+template<class T>
+std::optional<T> WorkStealingDeque<T>::steal()
+{
+    auto top = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto bottom = _bottom.load(std::memory_order_acquire);
+    if (top >= bottom)
+    {
+        return {};
+    }
+    auto* array = _array.load(std::memory_order_acquire);
+    auto value = array->get(top);
+    if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return {};
+    }
+    return value;
+}
+
+template<class T>
+bool WorkStealingDeque<T>::empty() const
+{
+    return _bottom.load(std::memory_order_relaxed) <= _top.load(std::memory_order_relaxed);
+}
+
+template<class T>
+typename WorkStealingDeque<T>::Array* WorkStealingDeque<T>::grow(Array* array, int64_t top, int64_t bottom)
+{
+    auto bigger = std::make_unique<Array>(2 * (array->mask + 1));
+    for (auto i = top; i < bottom; ++i)
+    {
+        bigger->put(i, array->get(i));
+    }
+    _arrays.push_back(std::move(bigger));
+    auto* grown = _arrays.back().get();
+    _array.store(grown, std::memory_order_release);
+    return grown;
+}
+}
@@ -1,18 +1,51 @@
 #include <iostream>
+#include <list>
+#include <iterator>
+#include <numeric>
 #include <thread>
+#include <ash/EventLoop.hpp>
 #include <ash/Module.hpp>
 #include <ash/Promise.hpp>
 
+#ifdef USE_STD_FUTURE
 constexpr int PERIOD_MS = 25;
+#else
+namespace {
+// One request flow: posts the request and prints the response once it arrives
+ash::Task<int> handleRequest(ash::Module& module, int x)
+{
+    auto result = co_await module.postRequest(x);
+    std::cout << result << std::endl;
+    co_return result;
+}
 
-int main()
+ash::Task<int> handleRequests(ash::EventLoop& loop, ash::Module& module, int count)
 {
-    std::list<ash::Module::DelayedResponse> responses;
-    ash::Module module;
-    for (int i = 0; i < 1000; ++i)
+    std::vector<ash::Future<int>> flows;
+    flows.reserve(count);
+    for (int i = 0; i < count; ++i)
     {
-        responses.push_back(module.postRequest(i));
+        flows.push_back(loop.spawn(handleRequest(module, i)));
     }
+    int total = 0;
+    for (auto& flow : co_await ash::whenAll(std::move(flows)))
+    {
+        total += flow.get();
+    }
+    co_return total;
+}
+}
+#endif
+
+int main()
+{
+#ifdef USE_STD_FUTURE
+    std::vector<int> requests(1000);
+    std::iota(requests.begin(), requests.end(), 0);
+    ash::Module module;
+    auto futures = module.postRequests(requests);
+    std::list<ash::Module::DelayedResponse> responses(std::make_move_iterator(futures.begin()),
+                                                      std::make_move_iterator(futures.end()));
 
     while (!responses.empty())
     {
@@ -32,4 +65,15 @@ int main()
         }
         std::this_thread::sleep_until(deadline);
     }
+#else
+    // All the flows wait on this thread; none of them polls
+    ash::EventLoop loop;
+    ash::Module module;
+    loop.runUntilComplete(handleRequests(loop, module, 1000));
+#endif
+
+    auto metrics = module.metrics();
+    std::clog << metrics.fulfilled << " requests, lateness p50 " << metrics.lateness.percentile(0.5).count()
+              << " ns, p99 " << metrics.lateness.percentile(0.99).count() << " ns, max "
+              << metrics.lateness.max().count() << " ns" << std::endl;
 }
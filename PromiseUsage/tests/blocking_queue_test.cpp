@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <ash/SpscQueue.hpp>
+
+// pop and push with a short timeout on an empty or full queue while another
+// thread keeps the CPU busy: each yield of the spin phase can then give the
+// CPU away for a whole time slice, so the spin must stop at the deadline.
+// Exits with 1 on failure.
+
+namespace {
+constexpr int ROUNDS = 20;
+constexpr auto TIMEOUT = std::chrono::milliseconds(1);
+// Far above a few scheduler ticks, far below SPIN_COUNT time slices
+constexpr auto LIMIT = std::chrono::milliseconds(50);
+
+template<class Operation>
+bool returnsNearTimeout(const char* name, Operation operation)
+{
+    std::atomic_bool stopping(false);
+    std::thread busy([&stopping]()
+    {
+        while (!stopping.load(std::memory_order_relaxed))
+        {
+        }
+    });
+    auto worst = std::chrono::steady_clock::duration::zero();
+    bool timedOut = true;
+    for (int i = 0; i < ROUNDS; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        timedOut = !operation() && timedOut;
+        worst = std::max(worst, std::chrono::steady_clock::now() - start);
+    }
+    stopping.store(true);
+    busy.join();
+    auto worstMs = std::chrono::duration<double, std::milli>(worst).count();
+    std::cout << name << ": worst " << worstMs << " ms for a " << TIMEOUT.count() << " ms timeout" << std::endl;
+    return timedOut && worst < LIMIT;
+}
+}
+
+int main()
+{
+    ash::SpscQueue<int> empty(16);
+    bool passed = returnsNearTimeout("pop", [&empty]() { return empty.pop(TIMEOUT).has_value(); });
+    ash::SpscQueue<int> full(1);
+    while (full.tryPush(0))
+    {
+    }
+    passed = returnsNearTimeout("push", [&full]() { return full.push(0, TIMEOUT); }) && passed;
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <ash/Promise.hpp>
+#include <ash/SpscQueue.hpp>
+
+// Promises made on one thread and fulfilled and dropped on another, as
+// ash::Module does: once warm, their shared states must come back to the
+// posting thread's pool instead of going through operator new. Also drops
+// states after the thread that allocated them has exited. Exits with 1 on
+// failure.
+
+namespace {
+constexpr int WARM_UP = 10'000;
+constexpr int REQUESTS = 100'000;
+
+std::atomic<long> allocations(0);
+
+using Request = std::pair<ash::Promise<int>, ash::Future<int>>;
+
+bool crossThreadSteadyState()
+{
+    ash::SpscQueue<Request> requests(64);
+    std::thread responder([&requests]()
+    {
+        for (int i = 0; i < WARM_UP + REQUESTS; ++i)
+        {
+            auto request = *requests.pop();
+            request.first.setValue(i);
+            if (request.second.get() != i)
+            {
+                std::cerr << "wrong value" << std::endl;
+            }
+        }
+    });
+    long before = 0;
+    for (int i = 0; i < WARM_UP + REQUESTS; ++i)
+    {
+        if (i == WARM_UP)
+        {
+            before = allocations.load();
+        }
+        ash::Promise<int> promise;
+        auto future = promise.getFuture();
+        requests.push(Request(std::move(promise), std::move(future)));
+    }
+    auto during = allocations.load() - before;
+    responder.join();
+    // Up to a queue's worth of states can be in flight when the pool runs dry
+    if (during > 1024)
+    {
+        std::cerr << during << " allocations for " << REQUESTS << " cross-thread requests" << std::endl;
+        return false;
+    }
+    std::cout << during << " allocations for " << REQUESTS << " cross-thread requests" << std::endl;
+    return true;
+}
+
+// The pool of an exited thread is freed by the last of its blocks
+bool freeAfterOwnerExits()
+{
+    std::vector<ash::Promise<int>> promises;
+    std::thread owner([&promises]()
+    {
+        for (int i = 0; i < 100; ++i)
+        {
+            promises.emplace_back();
+        }
+        promises.pop_back();
+    });
+    owner.join();
+    promises.clear();
+    return true;
+}
+}
+
+// The replacements below pair operator new with std::free on purpose, which
+// GCC would report as mismatched since it sees through them
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto* p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    auto align = static_cast<std::size_t>(alignment);
+    if (auto* p = std::aligned_alloc(align, (size + align - 1) / align * align))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+int main()
+{
+    bool passed = crossThreadSteadyState();
+    passed = freeAfterOwnerExits() && passed;
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,46 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <ash/SyncCircularBuffer.hpp>
+
+// pushBulk into a full buffer that a slow consumer drains one value at a
+// time: each wait for room succeeds, so only a deadline covering the whole
+// call makes it return near its timeout. Exits with 1 on failure.
+
+namespace {
+constexpr auto TIMEOUT = std::chrono::milliseconds(200);
+// The consumer alone would take 100 * 30 ms to let the whole range in
+constexpr auto LIMIT = std::chrono::milliseconds(1000);
+
+bool pushBulkTimeoutBoundsTheCall()
+{
+    ash::SyncCircularBuffer<int> buffer(4);
+    std::vector<int> values(100, 1);
+    std::atomic_bool stopping(false);
+    std::thread consumer([&buffer, &stopping]()
+    {
+        while (!stopping.load())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(30));
+            buffer.tryPop();
+        }
+    });
+    auto start = std::chrono::steady_clock::now();
+    auto pushed = buffer.pushBulk(values.begin(), values.end(), TIMEOUT);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    stopping.store(true);
+    consumer.join();
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+    std::cout << pushed << " values pushed in " << elapsedMs << " ms" << std::endl;
+    return elapsed >= TIMEOUT && elapsed < LIMIT && pushed < values.size();
+}
+}
+
+int main()
+{
+    bool passed = pushBulkTimeoutBoundsTheCall();
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <ash/Promise.hpp>
+
+// whenAny() hands back the futures that did not win; continuations attached
+// to them afterwards must run exactly once, whichever of the producers and
+// the consumer gets there first. Exits with 1 on failure.
+
+namespace {
+constexpr int ITERATIONS = 20'000;
+
+bool reattachAfterWhenAny()
+{
+    for (int iteration = 0; iteration < ITERATIONS; ++iteration)
+    {
+        ash::Promise<int> first;
+        ash::Promise<int> second;
+        std::vector<ash::Future<int>> futures;
+        futures.push_back(first.getFuture());
+        futures.push_back(second.getFuture());
+        auto any = ash::whenAny(std::move(futures));
+        // Relaxed, so that it does not order the producer before the
+        // continuation attached below
+        std::atomic_bool produced(false);
+        std::thread producer([&first, &second, &produced, iteration]()
+        {
+            // Both orders, so that either future can be the remaining one
+            if (iteration % 2)
+            {
+                first.setValue(1);
+                second.setValue(2);
+            }
+            else
+            {
+                second.setValue(2);
+                first.setValue(1);
+            }
+            produced.store(true, std::memory_order_relaxed);
+        });
+        auto result = any.get();
+        // Every other pair of iterations lets the producer complete the
+        // remaining future first
+        if (iteration % 4 >= 2)
+        {
+            while (!produced.load(std::memory_order_relaxed))
+            {
+                std::this_thread::yield();
+            }
+        }
+        auto& remaining = result.futures[1 - result.index];
+        std::atomic_int runs(0);
+        auto value = remaining.then(ash::inlineExecutor(), [&runs](ash::Future<int> future)
+        {
+            runs.fetch_add(1);
+            return future.get();
+        });
+        auto expected = result.index == 0 ? 2 : 1;
+        auto got = value.get();
+        producer.join();
+        if (runs.load() != 1 || got != expected)
+        {
+            std::cerr << "iteration " << iteration << ": continuation ran " << runs.load() << " times, value "
+                      << got << " instead of " << expected << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// The winner can fire while whenAny() is still attaching continuations
+bool whenAnyOnReadyFuture()
+{
+    ash::Promise<int> ready;
+    ash::Promise<int> pending;
+    ready.setValue(1);
+    std::vector<ash::Future<int>> futures;
+    futures.push_back(ready.getFuture());
+    futures.push_back(pending.getFuture());
+    auto result = ash::whenAny(std::move(futures)).get();
+    auto value = result.futures[1].then([](ash::Future<int> future) { return future.get() * 10; });
+    pending.setValue(2);
+    if (result.index != 0 || value.get() != 20)
+    {
+        std::cerr << "whenAny on a ready future: index " << result.index << std::endl;
+        return false;
+    }
+    return true;
+}
+}
+
+int main()
+{
+    bool passed = reattachAfterWhenAny();
+    passed = whenAnyOnReadyFuture() && passed;
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
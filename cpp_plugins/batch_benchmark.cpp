@@ -0,0 +1,54 @@
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "plugin.hpp"
+
+// Cost per item of the batch ABI of HelloWorld through PluginRegistry, with
+// batches of 1 to 1024 items, and cost of a set_parameter call through a
+// handle. Prints CSV: call,batch_size,ns_per_item
+
+static const size_t ITEMS = 1 << 20;
+
+template <typename Function>
+static double ns_per_item(Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / ITEMS;
+}
+
+int main() {
+    auto& registry = PluginRegistry::get_registry();
+    registry.load("./libhello_world.so");
+    auto plugin = registry.create("HelloWorld");
+
+    std::vector<PluginItem> items(ITEMS);
+    std::vector<PluginOutput> outputs(ITEMS);
+    for (size_t i = 0; i < ITEMS; ++i) {
+        items[i].value = static_cast<double>(i);
+    }
+
+    std::cout << "call,batch_size,ns_per_item" << std::endl;
+    for (size_t batch_size : {1, 16, 1024}) {
+        double ns = ns_per_item([&]() {
+            for (size_t i = 0; i < ITEMS; i += batch_size) {
+                PluginRegistry::process_batch(plugin, &items[i], batch_size, &outputs[i]);
+            }
+        });
+        std::cout << "process_batch," << batch_size << ',' << ns << std::endl;
+    }
+
+    int offset = PluginRegistry::parameter_handle(plugin, "offset");
+    double ns = ns_per_item([&]() {
+        for (size_t i = 0; i < ITEMS; ++i) {
+            PluginRegistry::set_parameter(plugin, offset, static_cast<double>(i));
+        }
+    });
+    std::cout << "set_parameter,1," << ns << std::endl;
+
+    // Keeps the calls above from being optimized away
+    if (outputs[ITEMS - 1].value < 0) {
+        std::cerr << "negative output" << std::endl;
+    }
+}
@@ -1,16 +1,44 @@
 #include "plugin.hpp"
+#include <cstring>
 #include <iostream>
 
+// Overridden to build many distinct plugins from this file, see load_benchmark
+#ifndef HELLO_WORLD_NAME
+#define HELLO_WORLD_NAME "HelloWorld"
+#endif
+
 class HelloWorld : public Plugin {
     public:
+        // Parameter handles of the batch ABI
+        enum Parameter { SCALE, OFFSET, PARAMETER_COUNT };
+        
         std::string get_message() const override {
             return "hello world!";
         }
+        
+        int set_parameter(int handle, double value) {
+            if (handle < 0 || handle >= PARAMETER_COUNT) {
+                return -1;
+            }
+            m_parameters[handle] = value;
+            return 0;
+        }
+        
+        void process_batch(const PluginItem* items, size_t count, PluginOutput* outputs) const {
+            double scale = m_parameters[SCALE];
+            double offset = m_parameters[OFFSET];
+            for (size_t i = 0; i < count; ++i) {
+                outputs[i].value = items[i].value * scale + offset;
+            }
+        }
+    
+    private:
+        double m_parameters[PARAMETER_COUNT] = { 1.0, 0.0 };
 };
 
 extern "C" {
     
-PluginInfo PLUGIN_INFO = { "HelloWorld",  PLUGIN_API_VERSION };
+PluginInfo PLUGIN_INFO = { HELLO_WORLD_NAME,  PLUGIN_API_VERSION };
 
 Plugin* create_new_plugin() {
     return new HelloWorld();
@@ -19,6 +47,24 @@ Plugin* create_new_plugin() {
 void delete_plugin(Plugin* plugin) {
     delete plugin;
 }
+
+int find_parameter(const char* parameter) {
+    if (std::strcmp(parameter, "scale") == 0) {
+        return HelloWorld::SCALE;
+    }
+    if (std::strcmp(parameter, "offset") == 0) {
+        return HelloWorld::OFFSET;
+    }
+    return -1;
+}
+
+int set_parameter(Plugin* plugin, int handle, double value) {
+    return static_cast<HelloWorld*>(plugin)->set_parameter(handle, value);
+}
+
+void process_batch(Plugin* plugin, const PluginItem* items, size_t count, PluginOutput* outputs) {
+    static_cast<HelloWorld*>(plugin)->process_batch(items, count, outputs);
+}
     
     
 }
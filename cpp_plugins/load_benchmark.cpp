@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "plugin.hpp"
+
+// Startup time for the plugins of benchmark_plugins/ (see the Makefile):
+// one load() per file, load_directory() without a cache, and
+// load_directory() with a metadata cache, first while the cache is written
+// and then once it is up to date, followed by the first create() of each
+// plugin, which is where the cached plugins pay for their dlopen.
+// Prints CSV: method,plugins,milliseconds
+
+static const char* DIRECTORY = "benchmark_plugins";
+static const char* CACHE_FILENAME = "load_benchmark.cache";
+
+static double milliseconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static size_t unload_all() {
+    auto& registry = PluginRegistry::get_registry();
+    auto names = registry.loaded_plugins();
+    for (auto& name : names) {
+        registry.unload(name);
+    }
+    return names.size();
+}
+
+static void report(const char* method, size_t plugins, double milliseconds) {
+    std::cout << method << ',' << plugins << ',' << milliseconds << std::endl;
+}
+
+int main() {
+    auto& registry = PluginRegistry::get_registry();
+    std::cout << "method,plugins,milliseconds" << std::endl;
+    
+    std::vector<std::string> filenames;
+    for (auto& file : std::filesystem::directory_iterator(DIRECTORY)) {
+        filenames.push_back(file.path().string());
+    }
+    std::sort(filenames.begin(), filenames.end());
+    auto start = std::chrono::steady_clock::now();
+    for (auto& filename : filenames) {
+        registry.load(filename);
+    }
+    report("load_each", filenames.size(), milliseconds_since(start));
+    unload_all();
+    
+    start = std::chrono::steady_clock::now();
+    registry.load_directory(DIRECTORY);
+    report("load_directory", filenames.size(), milliseconds_since(start));
+    unload_all();
+    
+    std::filesystem::remove(CACHE_FILENAME);
+    start = std::chrono::steady_clock::now();
+    registry.load_directory(DIRECTORY, CACHE_FILENAME);
+    report("load_directory_writing_cache", filenames.size(), milliseconds_since(start));
+    unload_all();
+    
+    start = std::chrono::steady_clock::now();
+    registry.load_directory(DIRECTORY, CACHE_FILENAME);
+    report("load_directory_from_cache", filenames.size(), milliseconds_since(start));
+    
+    auto names = registry.loaded_plugins();
+    start = std::chrono::steady_clock::now();
+    for (auto& name : names) {
+        registry.create(name);
+    }
+    report("first_create_after_cache", names.size(), milliseconds_since(start));
+    unload_all();
+}
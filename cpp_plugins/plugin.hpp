@@ -1,11 +1,21 @@
 #include <dlfcn.h>
 
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
 #include <functional>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
-#define PLUGIN_API_VERSION 1
+#define PLUGIN_API_VERSION 2
 
 
 class Plugin {
@@ -18,6 +28,25 @@ class Plugin {
 typedef Plugin* (*PluginFactory)();
 typedef void (*PluginDeleter)(Plugin*);
 
+// Batch ABI, exported by each library next to create_new_plugin and
+// delete_plugin. process_batch handles a whole batch in one call across the
+// .so boundary, and parameters are set through integer handles resolved
+// once from their name by find_parameter (-1 if unknown).
+// set_parameter returns 0, or -1 for an invalid handle.
+struct PluginItem {
+    double value;
+};
+
+struct PluginOutput {
+    double value;
+};
+
+extern "C" {
+typedef int (*PluginParameterFinder)(const char* parameter);
+typedef int (*PluginParameterSetter)(Plugin* plugin, int handle, double value);
+typedef void (*PluginBatchFunction)(Plugin* plugin, const PluginItem* items, size_t count, PluginOutput* outputs);
+}
+
 typedef std::shared_ptr<Plugin> PluginPtr;
 
 struct PluginInfo {
@@ -30,10 +59,162 @@ struct PluginEntry {
     void* dl_handler;
     PluginFactory factory_function;
     PluginDeleter deleter_function;
+    PluginParameterFinder find_parameter_function;
+    PluginParameterSetter set_parameter_function;
+    PluginBatchFunction batch_function;
+    std::string name;
     std::string filename;
-    int refcount;
+    // Opened up front by load() and reload(). Entries registered from the
+    // metadata cache of load_directory() are only opened by their first create().
+    std::once_flag open_flag;
+    // 0 once loaded, incremented by each reload
+    int version;
+    // Instances alive outside of the pool
+    std::atomic<int> refcount;
+    
+    // Instances released by their users, handed out again by create(). The
+    // pool is split in shards picked by thread so that threads creating
+    // instances concurrently mostly lock different mutexes.
+    struct alignas(64) PoolShard {
+        std::mutex mutex;
+        std::vector<Plugin*> plugins;
+    };
+    
+    static const size_t POOL_SHARDS = 8;
+    
+    PoolShard pool[POOL_SHARDS];
+    size_t pool_capacity;
+    size_t shard_capacity;
+    
+    // Only runs once the entry is unloaded and its last instance is gone,
+    // since every instance holds a reference to its entry
+    ~PluginEntry() {
+        for (auto& shard : pool) {
+            for (auto plugin : shard.plugins) {
+                deleter_function(plugin);
+            }
+        }
+        if (dl_handler != NULL) {
+            dlclose(dl_handler);
+        }
+    }
+    
+    // Fills in the fields read from the library
+    void open() {
+        dl_handler = dlopen(filename.c_str(), RTLD_LAZY);
+        check_dl_error();
+        
+        plugin_info = reinterpret_cast<PluginInfo*>(dlsym(dl_handler, "PLUGIN_INFO"));
+        check_dl_error();
+        
+        if (plugin_info->plugin_api_version != PLUGIN_API_VERSION) {
+            auto error_msg = filename + ": compiled with different plugin API version ("+
+                std::to_string(PLUGIN_API_VERSION) + " vs " + std::to_string(plugin_info->plugin_api_version) + ")";
+            close();
+            throw std::runtime_error(std::move(error_msg));
+        }
+        
+        factory_function = reinterpret_cast<PluginFactory>(dlsym(dl_handler, "create_new_plugin"));
+        check_dl_error();
+        
+        deleter_function = reinterpret_cast<PluginDeleter>(dlsym(dl_handler, "delete_plugin"));
+        check_dl_error();
+        
+        find_parameter_function = reinterpret_cast<PluginParameterFinder>(dlsym(dl_handler, "find_parameter"));
+        check_dl_error();
+        
+        set_parameter_function = reinterpret_cast<PluginParameterSetter>(dlsym(dl_handler, "set_parameter"));
+        check_dl_error();
+        
+        batch_function = reinterpret_cast<PluginBatchFunction>(dlsym(dl_handler, "process_batch"));
+        check_dl_error();
+    }
+    
+    void ensure_open() {
+        std::call_once(open_flag, [this]() {
+            if (dl_handler != NULL) {
+                return;
+            }
+            open();
+            // The library changed behind the back of the cache
+            if (name != plugin_info->plugin_name) {
+                auto error_msg = filename + ": expected plugin " + name + ", found " + plugin_info->plugin_name;
+                close();
+                throw std::runtime_error(std::move(error_msg));
+            }
+        });
+    }
+    
+    void close() {
+        dlclose(dl_handler);
+        dl_handler = NULL;
+    }
+    
+    void check_dl_error() {
+        char* error = dlerror();
+        if (error != NULL) {
+            if (dl_handler != NULL) {
+                close();
+            }
+            throw std::runtime_error(filename + ": " + error);
+        }
+    }
+    
+    void set_pool_capacity(size_t capacity) {
+        pool_capacity = capacity;
+        shard_capacity = (capacity + POOL_SHARDS - 1) / POOL_SHARDS;
+        for (auto& shard : pool) {
+            shard.plugins.reserve(shard_capacity);
+        }
+    }
+    
+    Plugin* acquire() {
+        if (shard_capacity != 0) {
+            auto& shard = local_shard();
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (!shard.plugins.empty()) {
+                auto plugin = shard.plugins.back();
+                shard.plugins.pop_back();
+                return plugin;
+            }
+        }
+        return factory_function();
+    }
+    
+    void release(Plugin* plugin) {
+        if (shard_capacity != 0) {
+            auto& shard = local_shard();
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (shard.plugins.size() < shard_capacity) {
+                shard.plugins.push_back(plugin);
+                return;
+            }
+        }
+        deleter_function(plugin);
+    }
+    
+    PoolShard& local_shard() {
+        thread_local size_t index = std::hash<std::thread::id>()(std::this_thread::get_id()) % POOL_SHARDS;
+        return pool[index];
+    }
+};
+
+typedef std::shared_ptr<PluginEntry> PluginEntryPtr;
+
+// Deleter of the instances handed out by create(). It owns a reference to
+// the entry, so the plugin's code stays loaded as long as the instance exists.
+struct PluginInstanceDeleter {
+    PluginEntryPtr entry;
+    
+    void operator()(Plugin* plugin) const {
+        entry->release(plugin);
+        entry->refcount.fetch_sub(1, std::memory_order_release);
+    }
 };
 
+// Thread-safe: create(), refcount() and reload() only take a shared lock,
+// load() and unload() an exclusive one. The entry of a name is swapped by
+// reload() with an atomic store, so readers never wait for a reload.
 class PluginRegistry {
     
     public:
@@ -51,74 +232,285 @@ class PluginRegistry {
         
         PluginRegistry& operator=(PluginRegistry&& other) = delete;
         
-        void load(const std::string& filename) {
-            void* dl_handler = dlopen(filename.c_str(), RTLD_LAZY);
-            check_dl_error(dl_handler, filename);
-            
-            auto info = reinterpret_cast<PluginInfo*>(dlsym(dl_handler, "PLUGIN_INFO"));
-            check_dl_error(dl_handler, filename);
+        // With a pool_capacity, up to that many released instances are kept
+        // and handed out again by create() instead of going through
+        // delete_plugin and create_new_plugin. Instances are recycled as they
+        // are, so only plugins without per-use state should be pooled.
+        void load(const std::string& filename, size_t pool_capacity = 0) {
+            // dlopen can be slow: the registry is only locked to insert the entry
+            auto entry = open_plugin(filename);
+            entry->set_pool_capacity(pool_capacity);
+            auto name = entry->name;
             
-            if (info->plugin_api_version != PLUGIN_API_VERSION) {
-                auto error_msg = filename + ": compiled with different plugin API version ("+
-                    std::to_string(PLUGIN_API_VERSION) + " vs " + std::to_string(info->plugin_api_version) + ")";
-                dlclose(dl_handler);
-                throw std::runtime_error(std::move(error_msg));
+            std::unique_lock<std::shared_mutex> lock(m_mutex);
+            bool registered = m_registered_plugins.emplace(name, std::move(entry)).second;
+            if (!registered) {
+                throw std::runtime_error(filename + ": duplicated plugin name (" + name + ")");
             }
+        }
+        
+        // Registers every .so file of directory, dlopening them and checking
+        // their plugin_api_version on several threads. With a cache_filename,
+        // the name, API version and modification time of each plugin are
+        // saved there, and the plugins whose file has not changed since are
+        // registered from the cache without being dlopened until their first
+        // create(). Plugins that fail to load are skipped; they are reported
+        // together, once the others are registered, by a runtime_error.
+        void load_directory(const std::string& directory, const std::string& cache_filename = "",
+                            size_t pool_capacity = 0) {
+            std::vector<std::string> filenames;
+            for (auto& file : std::filesystem::directory_iterator(directory)) {
+                if (file.is_regular_file() && file.path().extension() == ".so") {
+                    filenames.push_back(file.path().string());
+                }
+            }
+            std::sort(filenames.begin(), filenames.end());
             
-            std::string name(info->plugin_name);
-            
-            PluginEntry entry;
-            entry.plugin_info = info;
-            entry.dl_handler = dl_handler;
+            auto cache = read_cache(cache_filename);
+            std::vector<PluginEntryPtr> entries(filenames.size());
+            std::vector<long long> mtimes(filenames.size());
+            std::vector<std::string> errors(filenames.size());
+            std::vector<size_t> to_open;
+            for (size_t i = 0; i < filenames.size(); ++i) {
+                mtimes[i] = modification_time(filenames[i]);
+                auto cached = cache.find(filenames[i]);
+                if (cached != cache.end() && cached->second.mtime == mtimes[i] &&
+                    cached->second.api_version == PLUGIN_API_VERSION) {
+                    entries[i] = new_entry(filenames[i]);
+                    entries[i]->name = cached->second.name;
+                }
+                else {
+                    to_open.push_back(i);
+                }
+            }
             
-            entry.factory_function = reinterpret_cast<PluginFactory>(dlsym(dl_handler, "create_new_plugin"));
-            check_dl_error(dl_handler, filename);
+            std::atomic<size_t> next(0);
+            auto open_next = [&]() {
+                for (size_t k = next++; k < to_open.size(); k = next++) {
+                    auto i = to_open[k];
+                    try {
+                        entries[i] = open_plugin(filenames[i]);
+                    }
+                    catch (const std::exception& e) {
+                        errors[i] = e.what();
+                    }
+                }
+            };
+            size_t number_of_threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), to_open.size());
+            std::vector<std::thread> threads;
+            for (size_t t = 1; t < number_of_threads; ++t) {
+                threads.emplace_back(open_next);
+            }
+            open_next();
+            for (auto& thread : threads) {
+                thread.join();
+            }
             
-            entry.deleter_function = reinterpret_cast<PluginDeleter>(dlsym(dl_handler, "delete_plugin"));
-            check_dl_error(dl_handler, filename);
+            std::vector<CacheRecord> records;
+            {
+                std::unique_lock<std::shared_mutex> lock(m_mutex);
+                for (size_t i = 0; i < filenames.size(); ++i) {
+                    if (!entries[i]) {
+                        continue;
+                    }
+                    entries[i]->set_pool_capacity(pool_capacity);
+                    auto name = entries[i]->name;
+                    if (!m_registered_plugins.emplace(name, std::move(entries[i])).second) {
+                        errors[i] = filenames[i] + ": duplicated plugin name (" + name + ")";
+                        continue;
+                    }
+                    records.push_back({filenames[i], name, PLUGIN_API_VERSION, mtimes[i]});
+                }
+            }
+            write_cache(cache_filename, records);
             
-            entry.filename = filename;
-            entry.refcount = 0;
+            std::string error_msg;
+            for (auto& error : errors) {
+                if (!error.empty()) {
+                    error_msg += (error_msg.empty() ? "" : "\n") + error;
+                }
+            }
+            if (!error_msg.empty()) {
+                throw std::runtime_error(error_msg);
+            }
+        }
+        
+        // Loads a new version of an already loaded plugin, alongside the
+        // current one, and switches its name to it: instances created from
+        // then on come from the new version, while those of the old version
+        // keep its code loaded until the last of them is released. The new
+        // version must have its own path (e.g. libname.so.2), since dlopen
+        // hands back the already loaded library for a path it has opened.
+        void reload(const std::string& filename) {
+            std::lock_guard<std::mutex> reload_lock(m_reload_mutex);
+            auto entry = open_plugin(filename);
+            auto name = entry->name;
             
-            bool registered = m_registered_plugins.emplace(name, entry).second;
-            if (!registered) {
-                dlclose(dl_handler);
-                throw std::runtime_error(filename + ": duplicated plugin name (" + name + ")");
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            auto& current_slot = get_entry(name);
+            auto current = std::atomic_load(&current_slot);
+            current->ensure_open();
+            if (current->dl_handler == entry->dl_handler) {
+                throw std::runtime_error(filename + ": same library as the loaded version of " + name);
             }
+            entry->version = current->version + 1;
+            entry->set_pool_capacity(current->pool_capacity);
+            std::atomic_store(&current_slot, std::move(entry));
         }
         
         void unload(const std::string& plugin_name) {
+            std::unique_lock<std::shared_mutex> lock(m_mutex);
             auto& entry = get_entry(plugin_name);
-            if (entry.refcount != 0) {
+            // create() increments refcount under the shared lock, so it can't
+            // go up again before the entry is erased. Instances of versions
+            // replaced by reload() don't count.
+            if (entry->refcount.load() != 0) {
                 throw std::runtime_error(plugin_name + ": there still exist instance(s) of this plugin in memory");
             }
             m_registered_plugins.erase(plugin_name);
-            
         }
         
         PluginPtr create(const std::string& plugin_name) {
-            // TODO thread safety?
-            
-            auto& entry = get_entry(plugin_name);
-            
-            PluginPtr new_plugin(entry.factory_function(), [&](Plugin* ptr) {
-                --entry.refcount;
-                entry.deleter_function(ptr);
-            });
-            ++entry.refcount;
-
-            return new_plugin;
+            PluginEntryPtr entry;
+            {
+                std::shared_lock<std::shared_mutex> lock(m_mutex);
+                entry = std::atomic_load(&get_entry(plugin_name));
+                entry->refcount.fetch_add(1, std::memory_order_relaxed);
+            }
+            Plugin* plugin;
+            try {
+                entry->ensure_open();
+                plugin = entry->acquire();
+            }
+            catch (...) {
+                entry->refcount.fetch_sub(1, std::memory_order_relaxed);
+                throw;
+            }
+            return PluginPtr(plugin, PluginInstanceDeleter{std::move(entry)});
+        }
+        
+        // The batch ABI of an instance returned by create(), which goes to the
+        // library the instance comes from even after a reload()
+        static int parameter_handle(const PluginPtr& plugin, const std::string& parameter) {
+            auto& entry = entry_of(plugin);
+            int handle = entry.find_parameter_function(parameter.c_str());
+            if (handle < 0) {
+                throw std::runtime_error(entry.name + ": unknown parameter " + parameter);
+            }
+            return handle;
+        }
+        
+        static void set_parameter(const PluginPtr& plugin, int handle, double value) {
+            auto& entry = entry_of(plugin);
+            if (entry.set_parameter_function(plugin.get(), handle, value) != 0) {
+                throw std::runtime_error(entry.name + ": invalid parameter handle " + std::to_string(handle));
+            }
         }
         
+        static void process_batch(const PluginPtr& plugin, const PluginItem* items, size_t count, PluginOutput* outputs) {
+            entry_of(plugin).batch_function(plugin.get(), items, count, outputs);
+        }
+        
+        // Of the current version
         int refcount(const std::string& plugin_name) {
-            auto entry = get_entry(plugin_name);
-            return entry.refcount;
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            return std::atomic_load(&get_entry(plugin_name))->refcount.load(std::memory_order_acquire);
+        }
+        
+        int version(const std::string& plugin_name) {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            return std::atomic_load(&get_entry(plugin_name))->version;
+        }
+        
+        std::vector<std::string> loaded_plugins() {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            std::vector<std::string> names;
+            for (auto& plugin : m_registered_plugins) {
+                names.push_back(plugin.first);
+            }
+            return names;
         }
     
     
     private:
     
-        PluginEntry& get_entry(const std::string& name) {
+        struct CacheRecord {
+            std::string filename;
+            std::string name;
+            int api_version;
+            long long mtime;
+        };
+        
+        static PluginEntryPtr new_entry(const std::string& filename) {
+            auto entry = std::make_shared<PluginEntry>();
+            entry->plugin_info = NULL;
+            entry->dl_handler = NULL;
+            entry->factory_function = NULL;
+            entry->deleter_function = NULL;
+            entry->find_parameter_function = NULL;
+            entry->set_parameter_function = NULL;
+            entry->batch_function = NULL;
+            entry->filename = filename;
+            entry->version = 0;
+            entry->refcount = 0;
+            entry->set_pool_capacity(0);
+            return entry;
+        }
+        
+        static PluginEntryPtr open_plugin(const std::string& filename) {
+            auto entry = new_entry(filename);
+            entry->open();
+            entry->name = entry->plugin_info->plugin_name;
+            return entry;
+        }
+        
+        static long long modification_time(const std::string& filename) {
+            return std::filesystem::last_write_time(filename).time_since_epoch().count();
+        }
+        
+        // One line per plugin: filename, name, API version and mtime separated by tabs
+        static std::unordered_map<std::string, CacheRecord> read_cache(const std::string& cache_filename) {
+            std::unordered_map<std::string, CacheRecord> cache;
+            if (cache_filename.empty()) {
+                return cache;
+            }
+            std::ifstream file(cache_filename);
+            CacheRecord record;
+            while (std::getline(file, record.filename, '\t') && std::getline(file, record.name, '\t') &&
+                   file >> record.api_version >> record.mtime) {
+                file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                cache[record.filename] = record;
+            }
+            return cache;
+        }
+        
+        // Written aside and renamed, so that a crash never leaves a truncated cache
+        static void write_cache(const std::string& cache_filename, const std::vector<CacheRecord>& records) {
+            if (cache_filename.empty()) {
+                return;
+            }
+            auto temporary_filename = cache_filename + ".tmp";
+            {
+                std::ofstream file(temporary_filename);
+                for (auto& record : records) {
+                    file << record.filename << '\t' << record.name << '\t' << record.api_version << '\t'
+                         << record.mtime << '\n';
+                }
+            }
+            std::filesystem::rename(temporary_filename, cache_filename);
+        }
+        
+        static PluginEntry& entry_of(const PluginPtr& plugin) {
+            auto deleter = std::get_deleter<PluginInstanceDeleter>(plugin);
+            if (deleter == NULL) {
+                throw std::runtime_error("plugin instance not created by the registry");
+            }
+            return *deleter->entry;
+        }
+        
+        // The caller holds m_mutex; the entry is read and replaced with
+        // std::atomic_load and std::atomic_store
+        PluginEntryPtr& get_entry(const std::string& name) {
             auto it = m_registered_plugins.find(name);
             if (it == m_registered_plugins.end()) {
                 throw std::runtime_error(name + ": plugin not loaded");
@@ -126,19 +518,12 @@ class PluginRegistry {
             return it->second;
         }
     
-        void check_dl_error(void* dl_handler, const std::string& head) {
-            char* error = dlerror();
-            if (error != NULL) {
-                if (dl_handler != NULL) {
-                    dlclose(dl_handler);
-                }
-                throw std::runtime_error(head + ": " + error);
-            }
-        }
-    
         PluginRegistry() = default;
         
-        std::unordered_map<std::string, PluginEntry> m_registered_plugins;
+        std::shared_mutex m_mutex;
+        // Serializes reload() calls, which otherwise only hold m_mutex shared
+        std::mutex m_reload_mutex;
+        std::unordered_map<std::string, PluginEntryPtr> m_registered_plugins;
     
 };
 
@@ -0,0 +1,47 @@
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "plugin.hpp"
+
+// Create/destroy throughput of PluginRegistry with 1 to 8 threads, each
+// creating an instance, calling it once and releasing it in a loop, with and
+// without instance pooling. Prints CSV: pool_capacity,threads,ops_per_s
+
+static const int OPS_PER_THREAD = 200000;
+
+static double run(int number_of_threads) {
+    auto& registry = PluginRegistry::get_registry();
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < number_of_threads; ++t) {
+        threads.emplace_back([&registry]() {
+            size_t length = 0;
+            for (int i = 0; i < OPS_PER_THREAD; ++i) {
+                auto plugin = registry.create("HelloWorld");
+                length += plugin->get_message().size();
+            }
+            if (length == 0) {
+                std::cerr << "empty messages" << std::endl;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return number_of_threads * OPS_PER_THREAD / elapsed.count();
+}
+
+int main() {
+    auto& registry = PluginRegistry::get_registry();
+    std::cout << "pool_capacity,threads,ops_per_s" << std::endl;
+    for (size_t pool_capacity : {0, 64}) {
+        registry.load("./libhello_world.so", pool_capacity);
+        for (int number_of_threads : {1, 2, 4, 8}) {
+            std::cout << pool_capacity << ',' << number_of_threads << ',' << run(number_of_threads) << std::endl;
+        }
+        registry.unload("HelloWorld");
+    }
+}
@@ -12,6 +12,13 @@ int main() {
     auto plugin = registry.create("HelloWorld");
     cout << "refcount: " << registry.refcount("HelloWorld") << endl;
     cout << plugin->get_message() << endl;
+    
+    int scale = registry.parameter_handle(plugin, "scale");
+    registry.set_parameter(plugin, scale, 2.0);
+    PluginItem items[] = { {1.0}, {2.0}, {3.0} };
+    PluginOutput outputs[3];
+    registry.process_batch(plugin, items, 3, outputs);
+    cout << "batch: " << outputs[0].value << " " << outputs[1].value << " " << outputs[2].value << endl;
     plugin.reset();
     registry.unload("HelloWorld");
     cout << "refcount: " << registry.refcount("HelloWorld") << endl;
@@ -0,0 +1,94 @@
+#include <dlfcn.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "plugin.hpp"
+using namespace std;
+
+// Hot reload of HelloWorld from a copy of its library (libhello_world.so.2,
+// made by the Makefile) while threads keep creating instances of it
+
+static const int THREADS = 4;
+static const long CREATES = 1000;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        cerr << "FAILED: " << what << endl;
+        exit(1);
+    }
+}
+
+// Whether the library is still mapped, without loading it again
+static bool loaded(const char* filename) {
+    void* handle = dlopen(filename, RTLD_LAZY | RTLD_NOLOAD);
+    if (handle == NULL) {
+        return false;
+    }
+    dlclose(handle);
+    return true;
+}
+
+int main() {
+    auto& registry = PluginRegistry::get_registry();
+    registry.load("./libhello_world.so");
+    auto old_plugin = registry.create("HelloWorld");
+    int old_version = registry.version("HelloWorld");
+
+    atomic<bool> stopping(false);
+    atomic<long> created(0);
+    vector<thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&]() {
+            while (!stopping.load()) {
+                auto plugin = registry.create("HelloWorld");
+                check(plugin->get_message() == "hello world!", "message of an instance created during the reload");
+                created.fetch_add(1);
+            }
+        });
+    }
+    while (created.load() < CREATES) {
+        this_thread::yield();
+    }
+    registry.reload("./libhello_world.so.2");
+    long created_before_reload = created.load();
+    while (created.load() < created_before_reload + CREATES) {
+        this_thread::yield();
+    }
+    stopping.store(true);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    cout << created.load() << " instances created around the reload" << endl;
+
+    check(registry.version("HelloWorld") == old_version + 1, "version after reload");
+    check(old_plugin->get_message() == "hello world!", "old instance after reload");
+    PluginItem item = { 3.0 };
+    PluginOutput output;
+    registry.process_batch(old_plugin, &item, 1, &output);
+    check(output.value == 3.0, "batch ABI of the old instance after reload");
+
+    bool rejected = false;
+    try {
+        registry.reload("./libhello_world.so.2");
+    }
+    catch (const runtime_error& e) {
+        cout << "rejected: " << e.what() << endl;
+        rejected = true;
+    }
+    check(rejected, "reload of the library already loaded");
+
+    // The old instance is all that keeps the old version loaded
+    check(loaded("./libhello_world.so"), "old version loaded while an instance exists");
+    old_plugin.reset();
+    check(!loaded("./libhello_world.so"), "old version unloaded with its last instance");
+
+    registry.unload("HelloWorld");
+    check(registry.loaded_plugins().empty(), "unload after reload");
+    check(!loaded("./libhello_world.so.2"), "new version unloaded");
+    cout << "passed" << endl;
+}
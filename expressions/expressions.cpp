@@ -1,150 +1,782 @@
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <sstream>
-#include <variant>
+#include <unordered_map>
 #include <vector>
 using namespace std;
 
-class Expression;
-ostream& operator<<(ostream& out, const Expression& exp);
+struct ExpressionBase {
+    enum Type {num, var, add, mul, div, mod, eql, neq};
+
+    typedef int64_t integer;
+
+    // Arithmetic on integers wraps around on overflow
+    static integer wrap_add(integer l, integer r) {
+        return static_cast<integer>(static_cast<uint64_t>(l) + static_cast<uint64_t>(r));
+    }
+
+    static integer wrap_mul(integer l, integer r) {
+        return static_cast<integer>(static_cast<uint64_t>(l)*static_cast<uint64_t>(r));
+    }
+};
+
+// Bump allocator for the argument lists of the nodes. Nothing is freed
+// individually; everything goes away with the arena.
+template<class T>
+class Arena {
+    public:
+        T* allocate(size_t n) {
+            if (n > p_available) {
+                size_t chunk_size = max(n, CHUNK_SIZE);
+                p_chunks.emplace_back(new T[chunk_size]);
+                p_next = p_chunks.back().get();
+                p_available = chunk_size;
+            }
+            T* result = p_next;
+            p_next += n;
+            p_available -= n;
+            return result;
+        }
+
+        size_t bytes() const {
+            return p_chunks.size()*CHUNK_SIZE*sizeof(T);
+        }
+
+    private:
+        static constexpr size_t CHUNK_SIZE = 1 << 14;
+
+        vector<unique_ptr<T[]>> p_chunks;
+        T* p_next = nullptr;
+        size_t p_available = 0;
+};
 
-class Expression {
+// Hash-consed store of expression nodes. Structurally identical expressions
+// are represented by the same node id, and variable names are interned to
+// integer symbols, so comparing two expressions for equality is comparing
+// two integers.
+class ExpressionStore : public ExpressionBase {
     public:
-        enum Type {num, var, add, mul, div, mod, eql, neq};
+        typedef uint32_t NodeId;
+        typedef uint32_t Symbol;
 
-        typedef int64_t integer;
+        struct Node {
+            Type type;
+            uint32_t arity;
+            union {
+                integer value;
+                Symbol symbol;
+            };
+            const NodeId* args;
+            size_t hash;
+        };
 
-        Expression(integer value = 0) : p_type(num), p_content(value) {
+        static ExpressionStore& global() {
+            static ExpressionStore store;
+            return store;
         }
 
-        Expression(string variable) : p_type(var), p_content(move(variable)) {
+        NodeId number(integer value) {
+            Node node{};
+            node.type = num;
+            node.value = value;
+            return intern_node(node);
         }
 
-        Type type() const {
-            return p_type;
+        NodeId variable(string_view name) {
+            Node node{};
+            node.type = var;
+            node.symbol = intern(name);
+            return intern_node(node);
         }
 
-        int as_num() const {
-            return get<integer>(p_content);
+        NodeId compound(Type type, const NodeId* args, size_t arity) {
+            Node node{};
+            node.type = type;
+            node.arity = arity;
+            node.args = args;
+            return intern_node(node);
         }
 
-        const string& as_var() const {
-            return get<string>(p_content);
+        NodeId compound(Type type, const vector<NodeId>& args) {
+            return compound(type, args.data(), args.size());
         }
 
-        bool atomic() const {
-            return p_type == num || p_type == var;
+        const Node& node(NodeId id) const {
+            return p_nodes[id];
         }
 
-        const Expression& arg(int i) const {
-            return p_arguments[i];
+        Symbol intern(string_view name) {
+            auto it = p_symbols.find(name);
+            if (it != p_symbols.end())
+                return it->second;
+            Symbol symbol = p_symbol_names.size();
+            // deque never relocates its elements, so the views stay valid
+            p_symbol_names.emplace_back(name);
+            p_symbols.emplace(p_symbol_names.back(), symbol);
+            return symbol;
         }
 
-        int arguments() const {
-            return p_arguments.size();
+        const string& symbol_name(Symbol symbol) const {
+            return p_symbol_names[symbol];
         }
 
-        Expression simplify() const {
-            Expression simplified;
-            switch (p_type) {
-                case num:
-                case var: {
-                    simplified = *this;
-                    vector<Expression> arguments;
-                    break;
+        size_t nodes() const {
+            return p_nodes.size();
+        }
+
+        size_t bytes() const {
+            return p_nodes.capacity()*sizeof(Node) + p_index.capacity()*sizeof(NodeId) + p_arguments.bytes();
+        }
+
+    private:
+        static constexpr NodeId EMPTY = UINT32_MAX;
+
+        ExpressionStore() : p_index(1024, EMPTY) {
+        }
+
+        static size_t combine(size_t seed, size_t value) {
+            return seed ^ (value + 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2));
+        }
+
+        static size_t hash_node(const Node& node) {
+            size_t hash = combine(node.type, node.arity);
+            if (node.type == num)
+                hash = combine(hash, static_cast<size_t>(node.value));
+            else if (node.type == var)
+                hash = combine(hash, node.symbol);
+            for (uint32_t i = 0; i < node.arity; ++i)
+                hash = combine(hash, node.args[i]);
+            return hash;
+        }
+
+        static bool same_node(const Node& l, const Node& r) {
+            if (l.type != r.type || l.arity != r.arity)
+                return false;
+            if (l.type == num)
+                return l.value == r.value;
+            if (l.type == var)
+                return l.symbol == r.symbol;
+            return memcmp(l.args, r.args, l.arity*sizeof(NodeId)) == 0;
+        }
+
+        // Returns the id of the node equal to the given one, creating it (and
+        // copying its arguments into the arena) if it does not exist yet.
+        NodeId intern_node(Node node) {
+            node.hash = hash_node(node);
+            size_t mask = p_index.size() - 1;
+            size_t slot = node.hash & mask;
+            while (p_index[slot] != EMPTY) {
+                const Node& candidate = p_nodes[p_index[slot]];
+                if (candidate.hash == node.hash && same_node(candidate, node))
+                    return p_index[slot];
+                slot = (slot + 1) & mask;
+            }
+            if (node.arity > 0) {
+                NodeId* args = p_arguments.allocate(node.arity);
+                copy(node.args, node.args + node.arity, args);
+                node.args = args;
+            }
+            NodeId id = p_nodes.size();
+            p_nodes.push_back(node);
+            p_index[slot] = id;
+            if (2*p_nodes.size() > p_index.size())
+                grow_index();
+            return id;
+        }
+
+        void grow_index() {
+            vector<NodeId> index(2*p_index.size(), EMPTY);
+            size_t mask = index.size() - 1;
+            for (NodeId id = 0; id < p_nodes.size(); ++id) {
+                size_t slot = p_nodes[id].hash & mask;
+                while (index[slot] != EMPTY)
+                    slot = (slot + 1) & mask;
+                index[slot] = id;
+            }
+            p_index = move(index);
+        }
+
+        vector<Node> p_nodes;
+        vector<NodeId> p_index;
+        Arena<NodeId> p_arguments;
+        unordered_map<string_view, Symbol> p_symbols;
+        deque<string> p_symbol_names;
+};
+
+// Simplifies expressions by rewriting them to a fixed point. Nodes are
+// immutable and hash-consed, so the result of simplifying a node is memoized
+// by node id and shared by every expression that contains it. The traversal
+// uses an explicit stack, so the nesting depth of the expression is only
+// limited by memory, and the number of rewrites per call is bounded: once the
+// budget is spent the remaining nodes are only rebuilt from their simplified
+// arguments.
+class Simplifier : public ExpressionBase {
+    public:
+        typedef ExpressionStore::NodeId NodeId;
+
+        static constexpr size_t DEFAULT_MAX_REWRITES = 1 << 24;
+
+        explicit Simplifier(ExpressionStore& store, size_t max_rewrites = DEFAULT_MAX_REWRITES)
+            : p_store(store), p_max_rewrites(max_rewrites) {
+        }
+
+        static Simplifier& global() {
+            static Simplifier simplifier(ExpressionStore::global());
+            return simplifier;
+        }
+
+        NodeId simplify(NodeId root) {
+            size_t rewrites = 0;
+            vector<Frame> stack{{root, NONE}};
+            while (!stack.empty()) {
+                Frame frame = stack.back();
+                if (memo(frame.id) != NONE) {
+                    stack.pop_back();
+                    continue;
+                }
+                if (frame.rewritten != NONE) {
+                    // The rewritten form has been simplified by now
+                    set_memo(frame.id, memo(frame.rewritten));
+                    stack.pop_back();
+                    continue;
+                }
+                bool ready = true;
+                const ExpressionStore::Node& node = p_store.node(frame.id);
+                for (uint32_t i = 0; i < node.arity; ++i) {
+                    if (memo(node.args[i]) == NONE) {
+                        stack.push_back({node.args[i], NONE});
+                        ready = false;
+                    }
                 }
+                if (!ready)
+                    continue;
+                NodeId rebuilt = rebuild(frame.id);
+                NodeId rewritten = p_truncated? rebuilt : rewrite(rebuilt);
+                if (rewritten == rebuilt) {
+                    set_memo(rebuilt, rebuilt);
+                    set_memo(frame.id, rebuilt);
+                    stack.pop_back();
+                }
+                else {
+                    p_truncated = ++rewrites == p_max_rewrites;
+                    stack.back().rewritten = rewritten;
+                    stack.push_back({rewritten, NONE});
+                }
+            }
+            NodeId simplified = memo(root);
+            p_truncated = false;
+            p_partial.clear();
+            return simplified;
+        }
+
+    private:
+        static constexpr NodeId NONE = UINT32_MAX;
+
+        struct Frame {
+            NodeId id;
+            NodeId rewritten;
+        };
+
+        NodeId memo(NodeId id) const {
+            if (id < p_memo.size() && p_memo[id] != NONE)
+                return p_memo[id];
+            auto it = p_partial.find(id);
+            return it == p_partial.end()? NONE : it->second;
+        }
+
+        // Results computed after running out of rewrites are not necessarily
+        // in normal form, so they are only remembered until the call ends.
+        void set_memo(NodeId id, NodeId simplified) {
+            if (p_truncated) {
+                p_partial[id] = simplified;
+                return;
+            }
+            if (id >= p_memo.size())
+                p_memo.resize(max<size_t>(p_store.nodes(), id + 1), NONE);
+            p_memo[id] = simplified;
+        }
+
+        // The node with every argument replaced by its simplified form
+        NodeId rebuild(NodeId id) {
+            const ExpressionStore::Node& node = p_store.node(id);
+            if (node.arity == 0)
+                return id;
+            p_args.clear();
+            for (uint32_t i = 0; i < node.arity; ++i)
+                p_args.push_back(memo(node.args[i]));
+            return p_store.compound(node.type, p_args);
+        }
+
+        NodeId number(integer value) {
+            return p_store.number(value);
+        }
+
+        NodeId binary(Type type, NodeId arg0, NodeId arg1) {
+            NodeId args[] = {arg0, arg1};
+            return p_store.compound(type, args, 2);
+        }
+
+        static bool divisible(integer l, integer r) {
+            return r != 0 && !(l == INT64_MIN && r == -1);
+        }
+
+        // Applies one rewrite rule at the root of a node whose arguments are
+        // already simplified. Returns the node itself if no rule applies.
+        NodeId rewrite(NodeId id) {
+            const ExpressionStore::Node& node = p_store.node(id);
+            switch (node.type) {
+                case num:
+                case var:
+                    return id;
                 case add:
                 case mul: {
-                    integer neutral = p_type==add? 0 : 1;
+                    Type op = node.type;
+                    integer neutral = op==add? 0 : 1;
                     integer acc = neutral;
-                    for (const Expression& arg : p_arguments) {
-                        Expression simplified_arg = arg.simplify();
-                        if (simplified_arg.type() == num) {
-                            integer value = simplified_arg.as_num();
-                            if (p_type == add)
-                                acc += value;
-                            else {
-                                acc *= value;
-                                if (value == 0) {
-                                    simplified.p_arguments.clear();
-                                    break;
-                                }
-                            }
+                    size_t constants = 0;
+                    bool flattened = false;
+                    vector<NodeId> args;
+                    for (uint32_t i = 0; i < node.arity; ++i) {
+                        const ExpressionStore::Node& arg = p_store.node(node.args[i]);
+                        if (arg.type == num) {
+                            ++constants;
+                            if (op == add)
+                                acc = wrap_add(acc, arg.value);
+                            else
+                                acc = wrap_mul(acc, arg.value);
+                        }
+                        else if (arg.type == op) {
+                            args.insert(args.end(), arg.args, arg.args + arg.arity);
+                            flattened = true;
                         }
                         else
-                            simplified.p_arguments.push_back(move(simplified_arg));
-                    }
-
-                    if (acc != neutral || simplified.arguments() == 0) {
-                        simplified.p_arguments.emplace_back(acc);
+                            args.push_back(node.args[i]);
                     }
-
-                    if (simplified.arguments() == 1)
-                        simplified = move(simplified.arg(0));
-                    else
-                        simplified.p_type = p_type;
-                    break;
+                    if (op == mul && acc == 0 && constants > 0)
+                        return number(0);
+                    bool trailing_constant = constants == 1 && p_store.node(node.args[node.arity - 1]).type == num;
+                    if (!flattened && acc != neutral && trailing_constant)
+                        return id;
+                    if (!flattened && constants == 0)
+                        return id;
+                    if (acc != neutral || args.empty())
+                        args.push_back(number(acc));
+                    if (args.size() == 1)
+                        return args[0];
+                    return p_store.compound(op, args);
                 }
                 case div: {
-                    Expression arg0 = p_arguments[0].simplify();
-                    Expression arg1 = p_arguments[1].simplify();
-                    if (arg0.p_type == div) {
-                        arg1 = (arg0.arg(1)*arg1).simplify();
-                        arg0 = move(arg0.arg(0));
-                    }
-                    if (arg0.p_type == num && arg1.p_type == num)
-                        simplified = arg0.as_num() / arg1.as_num();
-                    else if (arg1.p_type == num && arg1.as_num() == 1) {
-                        simplified = move(arg0);
-                    }
-                    else {
-                        simplified.p_arguments.push_back(move(arg0));
-                        simplified.p_arguments.push_back(move(arg1));
-                        simplified.p_type = div;
+                    NodeId arg0 = node.args[0], arg1 = node.args[1];
+                    const ExpressionStore::Node& node0 = p_store.node(arg0);
+                    const ExpressionStore::Node& node1 = p_store.node(arg1);
+                    if (node0.type == div) {
+                        NodeId numerator = node0.args[0];
+                        NodeId divisor = binary(mul, node0.args[1], arg1);
+                        return binary(div, numerator, divisor);
                     }
-                    break;
+                    if (node0.type == num && node1.type == num && divisible(node0.value, node1.value))
+                        return number(node0.value / node1.value);
+                    if (node1.type == num && node1.value == 1)
+                        return arg0;
+                    return id;
                 }
                 case eql: {
-                    Expression arg0 = p_arguments[0].simplify();
-                    Expression arg1 = p_arguments[1].simplify();
-                    if (arg0.p_type == num && arg1.p_type == num)
-                        simplified = integer(arg0.as_num() == arg1.as_num());
-                    else if (arg0.p_type == eql && arg1.p_type == num) {
-                        if (arg1.as_num() == 1)
-                            simplified = move(arg0);
-                        else if (arg1.as_num() == 0) {
-                            simplified = move(arg0);
-                            simplified.p_type = neq;
-                        }
-                    }
-                    else {
-                        simplified.p_arguments.push_back(move(arg0));
-                        simplified.p_arguments.push_back(move(arg1));
-                        simplified.p_type = eql;
+                    const ExpressionStore::Node& node0 = p_store.node(node.args[0]);
+                    const ExpressionStore::Node& node1 = p_store.node(node.args[1]);
+                    if (node0.type == num && node1.type == num)
+                        return number(node0.value == node1.value);
+                    if ((node0.type == eql || node0.type == neq) && node1.type == num) {
+                        if (node1.value == 1)
+                            return node.args[0];
+                        if (node1.value == 0)
+                            return binary(node0.type == eql? neq : eql, node0.args[0], node0.args[1]);
                     }
-                    break;
+                    return id;
                 }
                 default: {
-                    Expression arg0 = p_arguments[0].simplify();
-                    Expression arg1 = p_arguments[1].simplify();
-                    if (arg0.p_type == num && arg1.p_type == num) {
-                        integer arg0_value = arg0.as_num();
-                        integer arg1_value = arg1.as_num();
-                        if (p_type == mod) simplified = arg0_value % arg1_value;
-                        else simplified = integer(arg0_value != arg1_value);
+                    const ExpressionStore::Node& node0 = p_store.node(node.args[0]);
+                    const ExpressionStore::Node& node1 = p_store.node(node.args[1]);
+                    if (node0.type == num && node1.type == num) {
+                        if (node.type == neq)
+                            return number(node0.value != node1.value);
+                        if (divisible(node0.value, node1.value))
+                            return number(node0.value % node1.value);
+                    }
+                    return id;
+                }
+            }
+        }
+
+        ExpressionStore& p_store;
+        size_t p_max_rewrites;
+        vector<NodeId> p_memo;
+        unordered_map<NodeId, NodeId> p_partial;
+        bool p_truncated = false;
+        vector<NodeId> p_args;
+};
+
+// Canonical form of expressions as sparse multivariate polynomials with
+// integer coefficients. Subexpressions that are not sums or products (
+// variables, but also divisions, modulos and comparisons, after
+// canonicalizing their arguments) are the atoms of the polynomials.
+// Monomials are interned, and the terms of a polynomial are sorted by
+// decreasing degree and then lexicographically by atom, so two expressions
+// that are equal as polynomials get the same canonical node, and comparing
+// canonical ids decides that equality. Like simplification, results are
+// memoized by node id and the traversal does not recurse.
+class Canonicalizer : public ExpressionBase {
+    public:
+        typedef ExpressionStore::NodeId NodeId;
+        typedef uint32_t MonomialId;
+
+        struct Term {
+            MonomialId monomial;
+            integer coefficient;
+        };
+
+        typedef vector<Term> Polynomial;
+
+        explicit Canonicalizer(ExpressionStore& store) : p_store(store) {
+            p_constant = intern_monomial({});
+        }
+
+        static Canonicalizer& global() {
+            static Canonicalizer canonicalizer(ExpressionStore::global());
+            return canonicalizer;
+        }
+
+        NodeId canonicalize(NodeId root) {
+            vector<pair<NodeId, bool>> stack{{root, false}};
+            while (!stack.empty()) {
+                auto [id, expanded] = stack.back();
+                if (canonical(id) != NONE) {
+                    stack.pop_back();
+                    continue;
+                }
+                const ExpressionStore::Node& node = p_store.node(id);
+                if (!expanded && node.arity > 0) {
+                    stack.back().second = true;
+                    for (uint32_t i = 0; i < node.arity; ++i)
+                        if (canonical(node.args[i]) == NONE)
+                            stack.push_back({node.args[i], false});
+                    continue;
+                }
+                stack.pop_back();
+                set_canonical(id, to_expression(polynomial_of(id)));
+            }
+            return canonical(root);
+        }
+
+        // Polynomial of a canonical node
+        const Polynomial& polynomial(NodeId canonical_id) const {
+            return p_polynomials.at(canonical_id);
+        }
+
+        size_t monomials() const {
+            return p_monomials.size();
+        }
+
+    private:
+        static constexpr NodeId NONE = UINT32_MAX;
+
+        // Flattened (atom, exponent) pairs sorted by atom
+        typedef vector<uint32_t> Monomial;
+
+        struct MonomialHash {
+            size_t operator()(const Monomial& monomial) const {
+                size_t hash = monomial.size();
+                for (uint32_t x : monomial)
+                    hash = hash*0x100000001B3ull ^ x;
+                return hash;
+            }
+        };
+
+        NodeId canonical(NodeId id) const {
+            return id < p_canonical.size()? p_canonical[id] : NONE;
+        }
+
+        // The canonical node is also recorded as its own canonical form, but
+        // only once its arguments are canonical: otherwise canonicalizing it
+        // again would depend on which expression produced it first.
+        void set_canonical(NodeId id, NodeId canonical_id) {
+            size_t needed = max(id, canonical_id) + 1;
+            if (needed > p_canonical.size())
+                p_canonical.resize(max<size_t>(p_store.nodes(), needed), NONE);
+            p_canonical[id] = canonical_id;
+            if (arguments_canonical(canonical_id))
+                p_canonical[canonical_id] = canonical_id;
+        }
+
+        bool arguments_canonical(NodeId id) const {
+            const ExpressionStore::Node& node = p_store.node(id);
+            for (uint32_t i = 0; i < node.arity; ++i) {
+                NodeId arg = node.args[i];
+                Type type = p_store.node(arg).type;
+                if (type != num && type != var && canonical(arg) != arg)
+                    return false;
+            }
+            return true;
+        }
+
+        MonomialId intern_monomial(Monomial monomial) {
+            auto it = p_monomial_index.find(monomial);
+            if (it != p_monomial_index.end())
+                return it->second;
+            uint32_t degree = 0;
+            for (size_t i = 1; i < monomial.size(); i += 2)
+                degree += monomial[i];
+            MonomialId id = p_monomials.size();
+            p_degrees.push_back(degree);
+            p_monomials.push_back(monomial);
+            p_monomial_index.emplace(move(monomial), id);
+            return id;
+        }
+
+        MonomialId multiply(MonomialId l, MonomialId r) {
+            if (l > r)
+                swap(l, r);
+            uint64_t key = (static_cast<uint64_t>(l) << 32) | r;
+            auto it = p_products.find(key);
+            if (it != p_products.end())
+                return it->second;
+            const Monomial& a = p_monomials[l];
+            const Monomial& b = p_monomials[r];
+            Monomial product;
+            size_t i = 0, j = 0;
+            while (i < a.size() || j < b.size()) {
+                if (j == b.size() || (i < a.size() && a[i] < b[j])) {
+                    product.insert(product.end(), {a[i], a[i + 1]});
+                    i += 2;
+                }
+                else if (i == a.size() || b[j] < a[i]) {
+                    product.insert(product.end(), {b[j], b[j + 1]});
+                    j += 2;
+                }
+                else {
+                    product.insert(product.end(), {a[i], a[i + 1] + b[j + 1]});
+                    i += 2;
+                    j += 2;
+                }
+            }
+            MonomialId id = intern_monomial(move(product));
+            p_products.emplace(key, id);
+            return id;
+        }
+
+        bool monomial_less(MonomialId l, MonomialId r) const {
+            if (p_degrees[l] != p_degrees[r])
+                return p_degrees[l] > p_degrees[r];
+            // Lexicographic order, with x*x before x*y
+            const Monomial& a = p_monomials[l];
+            const Monomial& b = p_monomials[r];
+            for (size_t i = 0; i < min(a.size(), b.size()); i += 2) {
+                if (a[i] != b[i])
+                    return a[i] < b[i];
+                if (a[i + 1] != b[i + 1])
+                    return a[i + 1] > b[i + 1];
+            }
+            return false;
+        }
+
+        // Collects the terms accumulated by monomial, dropping zeros, in
+        // canonical order
+        Polynomial collect(const unordered_map<MonomialId, integer>& terms) const {
+            Polynomial result;
+            for (const auto& [monomial, coefficient] : terms)
+                if (coefficient != 0)
+                    result.push_back({monomial, coefficient});
+            sort(result.begin(), result.end(), [this](const Term& l, const Term& r) {
+                return monomial_less(l.monomial, r.monomial);
+            });
+            return result;
+        }
+
+        Polynomial sum(const ExpressionStore::Node& node) {
+            unordered_map<MonomialId, integer> terms;
+            for (uint32_t i = 0; i < node.arity; ++i)
+                for (const Term& term : polynomial(canonical(node.args[i])))
+                    terms[term.monomial] = wrap_add(terms[term.monomial], term.coefficient);
+            return collect(terms);
+        }
+
+        Polynomial product(const ExpressionStore::Node& node) {
+            Polynomial result{{p_constant, 1}};
+            for (uint32_t i = 0; i < node.arity && !result.empty(); ++i) {
+                const Polynomial& factor = polynomial(canonical(node.args[i]));
+                unordered_map<MonomialId, integer> terms;
+                terms.reserve(result.size()*factor.size());
+                for (const Term& l : result)
+                    for (const Term& r : factor) {
+                        integer& coefficient = terms[multiply(l.monomial, r.monomial)];
+                        coefficient = wrap_add(coefficient, wrap_mul(l.coefficient, r.coefficient));
                     }
-                    else {
-                        simplified.p_arguments.push_back(p_arguments[0].simplify());
-                        simplified.p_arguments.push_back(p_arguments[1].simplify());
-                        simplified.p_type = p_type;
+                result = collect(terms);
+            }
+            return result;
+        }
+
+        Polynomial atom(NodeId id) {
+            return {{intern_monomial({id, 1}), 1}};
+        }
+
+        // Polynomial of a node whose arguments are already canonical
+        Polynomial polynomial_of(NodeId id) {
+            const ExpressionStore::Node& node = p_store.node(id);
+            switch (node.type) {
+                case num:
+                    if (node.value == 0)
+                        return {};
+                    return {{p_constant, node.value}};
+                case var:
+                    return atom(id);
+                case add:
+                    return sum(node);
+                case mul:
+                    return product(node);
+                default: {
+                    // The simplifier does not keep arguments canonical (the
+                    // div-of-div rewrite multiplies two divisors as they come),
+                    // so the arguments of its result are canonicalized and the
+                    // node simplified again until neither changes anything
+                    NodeId rebuilt = id;
+                    for (;;) {
+                        ExpressionStore::Node current = p_store.node(rebuilt);
+                        if (current.type == num || current.type == var || current.type == add || current.type == mul)
+                            break;
+                        NodeId args[] = {canonicalize(current.args[0]), canonicalize(current.args[1])};
+                        NodeId next = Simplifier::global().simplify(p_store.compound(current.type, args, 2));
+                        if (next == rebuilt)
+                            break;
+                        rebuilt = next;
                     }
-                    break;
+                    auto known = p_polynomials.find(rebuilt);
+                    if (known != p_polynomials.end())
+                        return known->second;
+                    const ExpressionStore::Node& simplified = p_store.node(rebuilt);
+                    if (simplified.type == num)
+                        return simplified.value == 0? Polynomial{} : Polynomial{{p_constant, simplified.value}};
+                    // Rewriting can turn the node into a sum or a product
+                    if (simplified.type == add || simplified.type == mul)
+                        return polynomial(canonicalize(rebuilt));
+                    return atom(rebuilt);
                 }
             }
+        }
 
-            return simplified;
+        NodeId to_expression(Polynomial polynomial) {
+            vector<NodeId> terms;
+            vector<NodeId> factors;
+            for (const Term& term : polynomial) {
+                factors.clear();
+                const Monomial& monomial = p_monomials[term.monomial];
+                for (size_t i = 0; i < monomial.size(); i += 2)
+                    factors.insert(factors.end(), monomial[i + 1], monomial[i]);
+                if (term.coefficient != 1 || factors.empty())
+                    factors.push_back(p_store.number(term.coefficient));
+                if (factors.size() == 1)
+                    terms.push_back(factors[0]);
+                else {
+                    // Built from canonical atoms, so canonical itself
+                    NodeId product = p_store.compound(mul, factors);
+                    p_polynomials.emplace(product, Polynomial{term});
+                    set_canonical(product, product);
+                    terms.push_back(product);
+                }
+            }
+            NodeId id;
+            if (terms.empty())
+                id = p_store.number(0);
+            else if (terms.size() == 1)
+                id = terms[0];
+            else
+                id = p_store.compound(add, terms);
+            p_polynomials.emplace(id, move(polynomial));
+            return id;
+        }
+
+        ExpressionStore& p_store;
+        MonomialId p_constant;
+        vector<Monomial> p_monomials;
+        vector<uint32_t> p_degrees;
+        unordered_map<Monomial, MonomialId, MonomialHash> p_monomial_index;
+        unordered_map<uint64_t, MonomialId> p_products;
+        unordered_map<NodeId, Polynomial> p_polynomials;
+        vector<NodeId> p_canonical;
+};
+
+class Expression;
+ostream& operator<<(ostream& out, const Expression& exp);
+
+// Handle to a node of the global ExpressionStore. Copying an expression
+// copies a node id, and building a compound expression only copies the ids
+// of its arguments, so subterms are shared instead of duplicated.
+class Expression : public ExpressionBase {
+    public:
+        typedef ExpressionStore::NodeId NodeId;
+
+        Expression(integer value = 0) : p_id(store().number(value)) {
+        }
+
+        Expression(const string& variable) : p_id(store().variable(variable)) {
+        }
+
+        static Expression from_id(NodeId id) {
+            Expression exp;
+            exp.p_id = id;
+            return exp;
+        }
+
+        NodeId id() const {
+            return p_id;
+        }
+
+        // Structural equality (operator== builds an equality expression)
+        bool same(const Expression& other) const {
+            return p_id == other.p_id;
+        }
+
+        Type type() const {
+            return node().type;
+        }
+
+        integer as_num() const {
+            return node().value;
+        }
+
+        const string& as_var() const {
+            return store().symbol_name(node().symbol);
+        }
+
+        bool atomic() const {
+            return type() == num || type() == var;
+        }
+
+        Expression arg(int i) const {
+            return from_id(node().args[i]);
+        }
+
+        int arguments() const {
+            return node().arity;
+        }
+
+        Expression simplify() const {
+            return from_id(Simplifier::global().simplify(p_id));
+        }
+
+        // Polynomial normal form: expressions that are equal as polynomials
+        // (over their non-arithmetic subexpressions) have the same canonical
+        // form, and hence the same id
+        Expression canonical() const {
+            return from_id(Canonicalizer::global().canonicalize(p_id));
         }
 
         Expression operator+(const Expression& other) const {
@@ -177,27 +809,39 @@ class Expression {
             return out.str();
         }
 
+        static ExpressionStore& store() {
+            return ExpressionStore::global();
+        }
+
     private:
 
+        const ExpressionStore::Node& node() const {
+            return store().node(p_id);
+        }
+
+        static Expression binary(Type type, const Expression& arg0, const Expression& arg1) {
+            NodeId args[] = {arg0.p_id, arg1.p_id};
+            return from_id(store().compound(type, args, 2));
+        }
+
         Expression new_compound_expression(Type type, const Expression& other) const {
-            Expression result;
-            result.p_type = type;
-            result.add_argument(*this);
-            result.add_argument(other);
-            return result;
+            if (type != add && type != mul)
+                return binary(type, *this, other);
+            vector<NodeId> args;
+            add_argument(args, type, *this);
+            add_argument(args, type, other);
+            return from_id(store().compound(type, args));
         }
 
-        void add_argument(const Expression& exp) {
-            if ((p_type == add || p_type == mul) && p_type == exp.p_type)
-                p_arguments.insert(p_arguments.end(),
-                        exp.p_arguments.begin(), exp.p_arguments.end());
+        static void add_argument(vector<NodeId>& args, Type type, const Expression& exp) {
+            const ExpressionStore::Node& exp_node = exp.node();
+            if (exp_node.type == type)
+                args.insert(args.end(), exp_node.args, exp_node.args + exp_node.arity);
             else
-                p_arguments.push_back(exp);
+                args.push_back(exp.p_id);
         }
 
-        Type p_type;
-        vector<Expression> p_arguments;
-        variant<integer,string> p_content;
+        NodeId p_id;
 };
 
 ostream& operator<<(ostream& out, const Expression& exp) {
@@ -218,7 +862,7 @@ ostream& operator<<(ostream& out, const Expression& exp) {
         default: {
             int op_index = static_cast<int>(exp.type());
             for (int i = 0; i < exp.arguments(); ++i) {
-                if (i != 0) 
+                if (i != 0)
                     out << operator_symbols[op_index];
                 if (exp.type() == Expression::add || exp.arg(i).atomic())
                     out << exp.arg(i);
@@ -232,5 +876,378 @@ ostream& operator<<(ostream& out, const Expression& exp) {
 }
 
 
+// Expression compiled to straight-line code for a register machine, for
+// evaluating the same expression over many variable assignments. Variables
+// are read from columns (one array per variable, in the order given by
+// variables()) and the program is run over blocks of BLOCK rows at a time,
+// each instruction being a tight loop over the rows of the block that the
+// compiler can vectorize. Arithmetic wraps around on overflow, and dividing
+// by zero yields 0 (both for div and mod).
+class Program : public ExpressionBase {
+    public:
+        typedef ExpressionStore::NodeId NodeId;
+
+        static constexpr size_t BLOCK = 256;
+
+        enum OpCode : uint8_t {ADD, MUL, DIV, MOD, EQL, NEQ};
+
+        // Operands index a slot table laid out as constants, then variables,
+        // then registers
+        struct Instruction {
+            OpCode op;
+            uint32_t dst;
+            uint32_t lhs;
+            uint32_t rhs;
+        };
+
+        static Program compile(const Expression& exp) {
+            return Compiler(exp.simplify()).compile();
+        }
+
+        const vector<string>& variables() const {
+            return p_variables;
+        }
+
+        const vector<Instruction>& code() const {
+            return p_code;
+        }
+
+        size_t registers() const {
+            return p_registers;
+        }
+
+        // out[i] = value of the expression with variable j equal to columns[j][i]
+        void evaluate(const integer* const* columns, size_t rows, integer* out) const {
+            size_t constants = p_constants.size();
+            size_t first_register = constants + p_variables.size();
+            vector<integer> storage((constants + p_registers)*BLOCK);
+            vector<const integer*> slots(first_register + p_registers);
+            for (size_t i = 0; i < constants; ++i) {
+                fill_n(&storage[i*BLOCK], BLOCK, p_constants[i]);
+                slots[i] = &storage[i*BLOCK];
+            }
+            integer* registers = storage.data() + constants*BLOCK;
+            for (size_t r = 0; r < p_registers; ++r)
+                slots[first_register + r] = registers + r*BLOCK;
+
+            for (size_t start = 0; start < rows; start += BLOCK) {
+                size_t n = min(BLOCK, rows - start);
+                for (size_t v = 0; v < p_variables.size(); ++v)
+                    slots[constants + v] = columns[v] + start;
+                for (const Instruction& ins : p_code) {
+                    integer* dst = registers + (ins.dst - first_register)*BLOCK;
+                    run(ins.op, dst, slots[ins.lhs], slots[ins.rhs], n);
+                }
+                copy_n(slots[p_result], n, out + start);
+            }
+        }
+
+        // Single assignment, with values in the order of variables()
+        integer evaluate(const vector<integer>& values) const {
+            vector<const integer*> columns;
+            for (const integer& value : values)
+                columns.push_back(&value);
+            integer result;
+            evaluate(columns.data(), 1, &result);
+            return result;
+        }
+
+        static integer apply(OpCode op, integer lhs, integer rhs) {
+            integer result;
+            run(op, &result, &lhs, &rhs, 1);
+            return result;
+        }
+
+    private:
+        static void run(OpCode op, integer* __restrict dst, const integer* __restrict lhs,
+                        const integer* __restrict rhs, size_t n) {
+            switch (op) {
+                case ADD:
+                    for (size_t i = 0; i < n; ++i)
+                        dst[i] = wrap_add(lhs[i], rhs[i]);
+                    break;
+                case MUL:
+                    for (size_t i = 0; i < n; ++i)
+                        dst[i] = wrap_mul(lhs[i], rhs[i]);
+                    break;
+                case DIV:
+                    for (size_t i = 0; i < n; ++i) {
+                        bool zero = rhs[i] == 0;
+                        // INT64_MIN/-1 overflows, but x/1 == -(x/-1) modulo 2^64
+                        bool overflow = rhs[i] == -1;
+                        integer divisor = zero || overflow? 1 : rhs[i];
+                        integer quotient = lhs[i]/divisor;
+                        quotient = overflow? static_cast<integer>(-static_cast<uint64_t>(quotient)) : quotient;
+                        dst[i] = zero? 0 : quotient;
+                    }
+                    break;
+                case MOD:
+                    for (size_t i = 0; i < n; ++i) {
+                        bool trivial = rhs[i] == 0 || rhs[i] == -1;
+                        integer divisor = trivial? 1 : rhs[i];
+                        dst[i] = trivial? 0 : lhs[i] % divisor;
+                    }
+                    break;
+                case EQL:
+                    for (size_t i = 0; i < n; ++i)
+                        dst[i] = lhs[i] == rhs[i];
+                    break;
+                case NEQ:
+                    for (size_t i = 0; i < n; ++i)
+                        dst[i] = lhs[i] != rhs[i];
+                    break;
+            }
+        }
+
+        class Compiler {
+            public:
+                explicit Compiler(const Expression& exp) : p_store(Expression::store()), p_root(exp.id()) {
+                }
+
+                Program compile() {
+                    Operand result = generate();
+                    Program program;
+                    program.p_constants = move(p_constants);
+                    for (ExpressionStore::Symbol symbol : p_variables)
+                        program.p_variables.push_back(p_store.symbol_name(symbol));
+                    allocate_registers(program, result);
+                    return program;
+                }
+
+            private:
+                enum Kind {CONSTANT, VARIABLE, VIRTUAL};
+
+                struct Operand {
+                    Kind kind;
+                    uint32_t index;
+                };
+
+                static OpCode opcode(Type type) {
+                    static const OpCode opcodes[] = {ADD, ADD, ADD, MUL, DIV, MOD, EQL, NEQ};
+                    return opcodes[type];
+                }
+
+                Operand constant(integer value) {
+                    auto it = p_constant_index.find(value);
+                    if (it == p_constant_index.end()) {
+                        it = p_constant_index.emplace(value, p_constants.size()).first;
+                        p_constants.push_back(value);
+                    }
+                    return {CONSTANT, it->second};
+                }
+
+                Operand variable(ExpressionStore::Symbol symbol) {
+                    auto it = p_variable_index.find(symbol);
+                    if (it == p_variable_index.end()) {
+                        it = p_variable_index.emplace(symbol, p_variables.size()).first;
+                        p_variables.push_back(symbol);
+                    }
+                    return {VARIABLE, it->second};
+                }
+
+                Operand emit(OpCode op, Operand lhs, Operand rhs) {
+                    if (lhs.kind == CONSTANT && rhs.kind == CONSTANT)
+                        return constant(apply(op, p_constants[lhs.index], p_constants[rhs.index]));
+                    p_virtual_code.push_back({op, lhs, rhs});
+                    return {VIRTUAL, static_cast<uint32_t>(p_virtual_code.size() - 1)};
+                }
+
+                // Post-order traversal with an explicit stack. Every node is
+                // compiled once, so shared subexpressions are computed once.
+                Operand generate() {
+                    vector<pair<NodeId, bool>> stack{{p_root, false}};
+                    while (!stack.empty()) {
+                        auto [id, expanded] = stack.back();
+                        stack.pop_back();
+                        if (p_operands.count(id))
+                            continue;
+                        const ExpressionStore::Node& node = p_store.node(id);
+                        if (node.type == num) {
+                            p_operands.emplace(id, constant(node.value));
+                            continue;
+                        }
+                        if (node.type == var) {
+                            p_operands.emplace(id, variable(node.symbol));
+                            continue;
+                        }
+                        if (!expanded) {
+                            stack.push_back({id, true});
+                            for (uint32_t i = node.arity; i > 0; --i)
+                                stack.push_back({node.args[i - 1], false});
+                            continue;
+                        }
+                        OpCode op = opcode(node.type);
+                        Operand acc = p_operands.at(node.args[0]);
+                        for (uint32_t i = 1; i < node.arity; ++i)
+                            acc = emit(op, acc, p_operands.at(node.args[i]));
+                        p_operands.emplace(id, acc);
+                    }
+                    return p_operands.at(p_root);
+                }
+
+                // Maps each virtual register to a physical one, reusing
+                // registers after their last use
+                void allocate_registers(Program& program, Operand result) {
+                    uint32_t constants = program.p_constants.size();
+                    uint32_t first_register = constants + program.p_variables.size();
+                    size_t n = p_virtual_code.size();
+                    vector<size_t> last_use(n, 0);
+                    for (size_t i = 0; i < n; ++i) {
+                        for (Operand operand : {p_virtual_code[i].lhs, p_virtual_code[i].rhs})
+                            if (operand.kind == VIRTUAL)
+                                last_use[operand.index] = i;
+                    }
+                    if (result.kind == VIRTUAL)
+                        last_use[result.index] = n;
+
+                    vector<uint32_t> physical(n);
+                    vector<uint32_t> free_registers;
+                    uint32_t registers = 0;
+                    auto slot = [&](Operand operand) -> uint32_t {
+                        switch (operand.kind) {
+                            case CONSTANT: return operand.index;
+                            case VARIABLE: return constants + operand.index;
+                            default: return first_register + physical[operand.index];
+                        }
+                    };
+                    for (size_t i = 0; i < n; ++i) {
+                        const VirtualInstruction& ins = p_virtual_code[i];
+                        if (free_registers.empty())
+                            physical[i] = registers++;
+                        else {
+                            physical[i] = free_registers.back();
+                            free_registers.pop_back();
+                        }
+                        program.p_code.push_back({ins.op, slot({VIRTUAL, static_cast<uint32_t>(i)}),
+                                                  slot(ins.lhs), slot(ins.rhs)});
+                        // Operands are released after picking the destination,
+                        // so an instruction never writes to its own operands
+                        for (Operand operand : {ins.lhs, ins.rhs}) {
+                            if (operand.kind == VIRTUAL && last_use[operand.index] == i) {
+                                free_registers.push_back(physical[operand.index]);
+                                last_use[operand.index] = n + 1;
+                            }
+                        }
+                    }
+                    program.p_registers = registers;
+                    program.p_result = slot(result);
+                }
+
+                struct VirtualInstruction {
+                    OpCode op;
+                    Operand lhs;
+                    Operand rhs;
+                };
+
+                const ExpressionStore& p_store;
+                NodeId p_root;
+                unordered_map<NodeId, Operand> p_operands;
+                vector<integer> p_constants;
+                unordered_map<integer, uint32_t> p_constant_index;
+                vector<ExpressionStore::Symbol> p_variables;
+                unordered_map<ExpressionStore::Symbol, uint32_t> p_variable_index;
+                vector<VirtualInstruction> p_virtual_code;
+        };
+
+        vector<integer> p_constants;
+        vector<string> p_variables;
+        vector<Instruction> p_code;
+        size_t p_registers = 0;
+        uint32_t p_result = 0;
+};
+
+
 int main() {
+    Expression a(string("a")), b(string("b")), c(string("c"));
+    Expression x(string("x")), y(string("y")), z(string("z"));
+    Expression sum = 0;
+    for (int i = 0; i < 1000; ++i)
+        sum = sum + (a*b + c)*Expression(i % 10);
+    cout << (a*b + c).same(a*b + c) << endl;
+    cout << (a*b + c) << endl;
+    cout << ((a*b + c)/2/3/(c/c/4)).simplify() << endl;
+    cout << (((a == b) == 0) == 1).simplify() << endl;
+    cout << ((a % 0) + (Expression(6) % 4) + a*1*0).simplify() << endl;
+
+    // Deeply nested expressions are simplified without recursion
+    Expression deep = a;
+    for (int i = 0; i < 100000; ++i)
+        deep = (deep/2 + 0) % 1000003;
+    Expression simplified = deep.simplify();
+    cout << simplified.same(deep.simplify()) << ' ' << (simplified.type() == Expression::mod) << endl;
+
+    auto start = chrono::steady_clock::now();
+    chrono::duration<double> elapsed;
+
+    // Canonical forms
+    Expression square = (x + y)*(y + x);
+    Expression expanded = x*x + y*x*2 + y*y;
+    cout << square.canonical() << " | " << expanded.canonical() << " | "
+         << square.canonical().same(expanded.canonical()) << endl;
+    cout << (x + x + x*2).canonical() << " | " << (x*2*y*3*x + (z/(x + 1 + 0)) + (z/(Expression(1) + x))*2).canonical() << endl;
+    // The div-of-div rewrite builds a*(b*c) style divisors in whatever order
+    // they come: canonical forms must not depend on which expression is
+    // canonicalized first
+    for (bool div_of_div_first : {false, true}) {
+        Canonicalizer canonicalizer(Expression::store());
+        Expression::NodeId nested = ((x/z)/y).id();
+        if (div_of_div_first)
+            canonicalizer.canonicalize(nested);
+        Expression::NodeId yz = canonicalizer.canonicalize((x/(y*z)).id());
+        Expression::NodeId zy = canonicalizer.canonicalize((x/(z*y)).id());
+        cout << (yz == zy) << ' ' << (yz == canonicalizer.canonicalize(nested)) << ' '
+             << (yz == canonicalizer.canonicalize((x/(y*z)).id())) << ' '
+             << (zy == canonicalizer.canonicalize((x/(z*y)).id())) << endl;
+    }
+    Expression sum_of_variables = 0;
+    for (int i = 0; i < 8; ++i)
+        sum_of_variables = sum_of_variables + Expression("v" + to_string(i));
+    Expression power = 1;
+    for (int i = 0; i < 6; ++i)
+        power = power*sum_of_variables;
+    start = chrono::steady_clock::now();
+    Expression power_canonical = power.canonical();
+    elapsed = chrono::steady_clock::now() - start;
+    cout << "(v0 + ... + v7)^6: " << power_canonical.arguments() << " terms in " << elapsed.count()*1e3 << " ms, "
+         << Canonicalizer::global().monomials() << " monomials" << endl;
+
+    // Constants are folded with the same wrapping arithmetic as compiled programs
+    Expression::integer max = INT64_MAX;
+    Expression overflowing_sum = Expression(max) + 1, overflowing_product = Expression(max)*3;
+    cout << overflowing_sum.simplify() << ' ' << overflowing_product.simplify() << ' '
+         << (overflowing_sum.simplify().as_num() == Program::apply(Program::ADD, max, 1)) << ' '
+         << (overflowing_product.simplify().as_num() == Program::apply(Program::MUL, max, 3)) << endl;
+
+    // Batched evaluation of a compiled expression over columns of values
+    Expression condition = ((x*3 + y*2 + 1) % 7 == z) + (x/(y + 0) != x*y*1)*(x + y);
+    Program program = Program::compile(condition);
+    cout << condition.simplify() << ": " << program.code().size() << " instructions, "
+         << program.registers() << " registers" << endl;
+    const size_t rows = 1 << 20;
+    vector<vector<Expression::integer>> values(program.variables().size(), vector<Expression::integer>(rows));
+    for (size_t v = 0; v < values.size(); ++v)
+        for (size_t i = 0; i < rows; ++i)
+            values[v][i] = static_cast<Expression::integer>((i*(2*v + 7)) % 101) - 50;
+    vector<const Expression::integer*> columns;
+    for (const auto& column : values)
+        columns.push_back(column.data());
+    vector<Expression::integer> results(rows);
+    start = chrono::steady_clock::now();
+    program.evaluate(columns.data(), rows, results.data());
+    elapsed = chrono::steady_clock::now() - start;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < rows; ++i) {
+        Expression::integer vx = 0, vy = 0, vz = 0;
+        for (size_t v = 0; v < values.size(); ++v) {
+            const string& name = program.variables()[v];
+            (name == "x"? vx : name == "y"? vy : vz) = values[v][i];
+        }
+        Expression::integer quotient = vy == 0? 0 : vx/vy;
+        Expression::integer expected = ((vx*3 + vy*2 + 1) % 7 == vz) + (quotient != vx*vy)*(vx + vy);
+        mismatches += results[i] != expected;
+    }
+    cout << rows << " rows in " << elapsed.count()*1e3 << " ms, " << mismatches << " mismatches" << endl;
+
+    cout << ExpressionStore::global().nodes() << " nodes, "
+         << ExpressionStore::global().bytes() << " bytes" << endl;
 }
@@ -0,0 +1,127 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <time.h>
+
+#include "concurrent_hashtable.h"
+
+/*
+ * Throughput of concurrent_hashtable_t with 1 to 64 threads under a
+ * read-heavy mix (90% find, 5% insert, 5% erase), the same mix issuing the
+ * finds in batches through concurrent_find_many, and a write-heavy mix
+ * (10% find, 45% insert, 45% erase).
+ */
+
+#define SHARD_BITS 6
+#define KEY_SPACE (1 << 20)
+#define BUCKETS_PER_SHARD (2*KEY_SPACE >> SHARD_BITS)
+#define OPS_PER_THREAD 500000
+#define FIND_BATCH 64
+
+typedef struct {
+  const char* name;
+  int find_percent;
+  int insert_percent;
+  bool batched;
+} workload_t;
+
+/* One cache line each, so that workers do not share lines */
+typedef struct {
+  concurrent_hashtable_t* ht;
+  const workload_t* workload;
+  uint64_t seed;
+  size_t hits;
+} __attribute__((aligned(CONCURRENT_HASHTABLE_CACHE_LINE))) worker_t;
+
+static inline uint64_t xorshift(uint64_t* state) {
+  uint64_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  return *state = x;
+}
+
+static void* run_worker(void* arg) {
+  worker_t* worker = arg;
+  const workload_t* workload = worker->workload;
+  uint64_t state = worker->seed;
+  int batch_keys[FIND_BATCH];
+  int batch_values[FIND_BATCH];
+  int pending = 0;
+  /* Counted locally and stored once at the end */
+  size_t hits = 0;
+  for (int op = 0; op < OPS_PER_THREAD; ++op) {
+    uint64_t r = xorshift(&state);
+    int key = (int)(r % KEY_SPACE);
+    int dice = (int)((r >> 32) % 100);
+    int value;
+    if (dice < workload->find_percent) {
+      if (workload->batched) {
+        batch_keys[pending++] = key;
+        if (pending == FIND_BATCH) {
+          hits += concurrent_find_many(worker->ht, batch_keys, FIND_BATCH, batch_values, NULL);
+          pending = 0;
+        }
+      }
+      else {
+        hits += concurrent_find(worker->ht, &key, &value);
+      }
+    }
+    else if (dice < workload->find_percent + workload->insert_percent) {
+      concurrent_insert_copy(worker->ht, &key, &key, NULL);
+    }
+    else {
+      concurrent_erase(worker->ht, &key);
+    }
+  }
+  if (pending > 0) {
+    hits += concurrent_find_many(worker->ht, batch_keys, pending, batch_values, NULL);
+  }
+  worker->hits = hits;
+  return NULL;
+}
+
+static double elapsed_seconds(const struct timespec* start, const struct timespec* end) {
+  return (double)(end->tv_sec - start->tv_sec) + 1e-9*(double)(end->tv_nsec - start->tv_nsec);
+}
+
+int main() {
+  static const workload_t workloads[] = {
+    { "read-heavy", 90, 5, false },
+    { "read-heavy (batched finds)", 90, 5, true },
+    { "write-heavy", 10, 45, false },
+  };
+  static const int thread_counts[] = { 1, 2, 4, 8, 16, 32, 64 };
+  const size_t number_of_thread_counts = sizeof(thread_counts)/sizeof(thread_counts[0]);
+
+  for (size_t w = 0; w < sizeof(workloads)/sizeof(workloads[0]); ++w) {
+    printf("%s\n%8s %14s\n", workloads[w].name, "threads", "Mops/s");
+    for (size_t t = 0; t < number_of_thread_counts; ++t) {
+      int number_of_threads = thread_counts[t];
+      concurrent_hashtable_t* ht = concurrent_hashtable_create(SHARD_BITS, BUCKETS_PER_SHARD);
+      /* Start half full */
+      for (int key = 0; key < KEY_SPACE; key += 2) {
+        concurrent_insert_copy(ht, &key, &key, NULL);
+      }
+      pthread_t threads[64];
+      worker_t workers[64];
+      struct timespec start, end;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for (int i = 0; i < number_of_threads; ++i) {
+        workers[i].ht = ht;
+        workers[i].workload = &workloads[w];
+        workers[i].seed = UINT64_C(0x9E3779B97F4A7C15)*(uint64_t)(i + 1);
+        workers[i].hits = 0;
+        pthread_create(&threads[i], NULL, run_worker, &workers[i]);
+      }
+      for (int i = 0; i < number_of_threads; ++i) {
+        pthread_join(threads[i], NULL);
+      }
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      double seconds = elapsed_seconds(&start, &end);
+      double total_ops = (double)number_of_threads*OPS_PER_THREAD;
+      printf("%8d %14.2f\n", number_of_threads, total_ops/seconds*1e-6);
+      concurrent_hashtable_destroy(ht);
+    }
+    printf("\n");
+  }
+}
@@ -0,0 +1,343 @@
+#ifndef CONCURRENT_HASHTABLE_H
+#define CONCURRENT_HASHTABLE_H
+
+#include <pthread.h>
+
+#include "hashtable.h"
+
+/*
+ * int -> int table shared between threads.
+ *
+ * Keys are routed by the high bits of their (mixed) hash to one of
+ * 2^shard_bits shards. Each shard is a fixed-size shard_table_t guarded by a
+ * mutex for writers and a sequence counter for readers: find first tries an
+ * optimistic read of the shard without taking any lock and only falls back
+ * to the mutex if a writer keeps interfering. Shard tables never rehash, so
+ * the memory an optimistic reader touches is never freed under its feet;
+ * whatever it reads while a write is in flight is discarded when the
+ * sequence check fails.
+ *
+ * The batch functions group the requests by shard so that each shard is
+ * locked (or validated) once per call.
+ *
+ * Needs _POSIX_C_SOURCE >= 200112L for posix_memalign.
+ */
+
+HASHTABLE_DEFINE(shard_table, int, int, int, int)
+
+#define CONCURRENT_HASHTABLE_CACHE_LINE 64
+#define CONCURRENT_HASHTABLE_OPTIMISTIC_RETRIES 8
+
+typedef struct {
+  pthread_mutex_t mutex;
+  /* Odd while a writer is modifying the table */
+  unsigned sequence;
+  shard_table_t* table;
+} __attribute__((aligned(CONCURRENT_HASHTABLE_CACHE_LINE))) concurrent_shard_t;
+
+typedef struct {
+  unsigned shard_bits;
+  size_t number_of_shards;
+  concurrent_shard_t* shards;
+} concurrent_hashtable_t;
+
+static inline size_t concurrent_mix_hash(size_t hash) {
+  uint64_t h = (uint64_t)hash*UINT64_C(0x9E3779B97F4A7C15);
+  return (size_t)(h ^ (h >> 29));
+}
+
+static inline size_t concurrent_shard_index(const concurrent_hashtable_t* ht, const int* key) {
+  if (ht->shard_bits == 0) {
+    return 0;
+  }
+  return concurrent_mix_hash(int_hash(key)) >> (8*sizeof(size_t) - ht->shard_bits);
+}
+
+static inline concurrent_hashtable_t* concurrent_hashtable_create(unsigned shard_bits, size_t buckets_per_shard) {
+  concurrent_hashtable_t* ht = malloc(sizeof(concurrent_hashtable_t));
+  void* shards;
+  ht->shard_bits = shard_bits;
+  ht->number_of_shards = (size_t)1 << shard_bits;
+  if (posix_memalign(&shards, CONCURRENT_HASHTABLE_CACHE_LINE, ht->number_of_shards*sizeof(concurrent_shard_t)) != 0) {
+    free(ht);
+    return NULL;
+  }
+  ht->shards = shards;
+  for (size_t i = 0; i < ht->number_of_shards; ++i) {
+    pthread_mutex_init(&(ht->shards[i].mutex), NULL);
+    ht->shards[i].sequence = 0;
+    ht->shards[i].table = shard_table_create(buckets_per_shard);
+  }
+  return ht;
+}
+
+static inline void concurrent_hashtable_destroy(concurrent_hashtable_t* ht) {
+  for (size_t i = 0; i < ht->number_of_shards; ++i) {
+    pthread_mutex_destroy(&(ht->shards[i].mutex));
+    shard_table_destroy(ht->shards[i].table);
+  }
+  free(ht->shards);
+  free(ht);
+}
+
+static inline void concurrent_shard_write_lock(concurrent_shard_t* shard) {
+  pthread_mutex_lock(&(shard->mutex));
+  __atomic_store_n(&(shard->sequence), shard->sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void concurrent_shard_write_unlock(concurrent_shard_t* shard) {
+  __atomic_store_n(&(shard->sequence), shard->sequence + 1, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&(shard->mutex));
+}
+
+static inline unsigned concurrent_shard_read_begin(const concurrent_shard_t* shard) {
+  return __atomic_load_n(&(shard->sequence), __ATOMIC_ACQUIRE);
+}
+
+static inline bool concurrent_shard_read_validate(const concurrent_shard_t* shard, unsigned sequence) {
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return (sequence & 1) == 0 && __atomic_load_n(&(shard->sequence), __ATOMIC_RELAXED) == sequence;
+}
+
+/* Number of keys across all shards; only exact if no writer is active */
+static inline size_t concurrent_hashtable_size(const concurrent_hashtable_t* ht) {
+  size_t size = 0;
+  for (size_t i = 0; i < ht->number_of_shards; ++i) {
+    size += __atomic_load_n(&(ht->shards[i].table->size), __ATOMIC_RELAXED);
+  }
+  return size;
+}
+
+/*
+ * Inserts a copy of key -> value if the key is not in the table. If existing
+ * is not NULL, it receives the value that was already associated to the key.
+ */
+static inline bool concurrent_insert_copy(concurrent_hashtable_t* ht, const int* key, const int* value, int* existing) {
+  concurrent_shard_t* shard = &(ht->shards[concurrent_shard_index(ht, key)]);
+  shard_table_entry_t* entry;
+  concurrent_shard_write_lock(shard);
+  bool inserted = shard_table_insert_copy(shard->table, key, value, &entry);
+  if (!inserted && entry != NULL && existing != NULL) {
+    *existing = entry->value;
+  }
+  concurrent_shard_write_unlock(shard);
+  return inserted;
+}
+
+static inline bool concurrent_erase(concurrent_hashtable_t* ht, const int* key) {
+  concurrent_shard_t* shard = &(ht->shards[concurrent_shard_index(ht, key)]);
+  concurrent_shard_write_lock(shard);
+  bool erased = shard_table_erase(shard->table, key);
+  concurrent_shard_write_unlock(shard);
+  return erased;
+}
+
+/* Copies the value associated to key into value, if there is one */
+static inline bool concurrent_find(concurrent_hashtable_t* ht, const int* key, int* value) {
+  concurrent_shard_t* shard = &(ht->shards[concurrent_shard_index(ht, key)]);
+  shard_table_entry_t* entry;
+  int found_value = 0;
+  for (int retry = 0; retry < CONCURRENT_HASHTABLE_OPTIMISTIC_RETRIES; ++retry) {
+    unsigned sequence = concurrent_shard_read_begin(shard);
+    if (sequence & 1) {
+      continue;
+    }
+    entry = shard_table_find(shard->table, key);
+    if (entry != NULL) {
+      found_value = entry->value;
+    }
+    if (concurrent_shard_read_validate(shard, sequence)) {
+      if (entry != NULL) {
+        *value = found_value;
+      }
+      return entry != NULL;
+    }
+  }
+  pthread_mutex_lock(&(shard->mutex));
+  entry = shard_table_find(shard->table, key);
+  if (entry != NULL) {
+    *value = entry->value;
+  }
+  pthread_mutex_unlock(&(shard->mutex));
+  return entry != NULL;
+}
+
+/*
+ * Stable counting sort of the n keys by shard. order receives the key
+ * indices grouped by shard and first (number_of_shards + 1 elements) the
+ * start of each group in order.
+ */
+static inline void concurrent_group_by_shard(const concurrent_hashtable_t* ht, const int* keys, size_t n,
+                                             size_t* shard_of, size_t* order, size_t* first) {
+  memset(first, 0, (ht->number_of_shards + 1)*sizeof(size_t));
+  for (size_t i = 0; i < n; ++i) {
+    shard_of[i] = concurrent_shard_index(ht, &keys[i]);
+    ++first[shard_of[i] + 1];
+  }
+  for (size_t s = 0; s < ht->number_of_shards; ++s) {
+    first[s + 1] += first[s];
+  }
+  for (size_t i = 0; i < n; ++i) {
+    order[first[shard_of[i]]++] = i;
+  }
+  /* The loop above advanced each start to the start of the next group */
+  for (size_t s = ht->number_of_shards; s > 0; --s) {
+    first[s] = first[s - 1];
+  }
+  first[0] = 0;
+}
+
+/* Size, in size_t, of the scratch space of the batch functions, up to which it is on the stack */
+#define CONCURRENT_HASHTABLE_STACK_SCRATCH 512
+
+static inline size_t concurrent_words(size_t bytes) {
+  return (bytes + sizeof(size_t) - 1)/sizeof(size_t);
+}
+
+/*
+ * Scratch space for shard_of, order and first, followed by extra_words: the
+ * stack buffer if it is large enough, otherwise a malloc'ed one, or NULL if
+ * malloc fails.
+ */
+static inline size_t* concurrent_batch_scratch(const concurrent_hashtable_t* ht, size_t n, size_t extra_words,
+                                               size_t* stack_scratch) {
+  size_t words = 2*n + ht->number_of_shards + 1 + extra_words;
+  if (words <= CONCURRENT_HASHTABLE_STACK_SCRATCH) {
+    return stack_scratch;
+  }
+  return malloc(words*sizeof(size_t));
+}
+
+static inline void concurrent_batch_scratch_free(size_t* scratch, size_t* stack_scratch) {
+  if (scratch != stack_scratch) {
+    free(scratch);
+  }
+}
+
+/*
+ * Inserts keys[i] -> values[i] for i in [0, n). inserted (optional) receives
+ * whether each key was new. Returns the number of new keys.
+ */
+static inline size_t concurrent_insert_many(concurrent_hashtable_t* ht, const int* keys, const int* values,
+                                            size_t n, bool* inserted) {
+  size_t stack_scratch[CONCURRENT_HASHTABLE_STACK_SCRATCH];
+  size_t* scratch = concurrent_batch_scratch(ht, n, 0, stack_scratch);
+  size_t count = 0;
+  if (scratch == NULL) {
+    /* Out of memory for grouping the keys: one lock per key instead */
+    for (size_t i = 0; i < n; ++i) {
+      bool new_key = concurrent_insert_copy(ht, &keys[i], &values[i], NULL);
+      count += new_key;
+      if (inserted != NULL) {
+        inserted[i] = new_key;
+      }
+    }
+    return count;
+  }
+  size_t* shard_of = scratch;
+  size_t* order = scratch + n;
+  size_t* first = scratch + 2*n;
+  concurrent_group_by_shard(ht, keys, n, shard_of, order, first);
+  for (size_t s = 0; s < ht->number_of_shards; ++s) {
+    if (first[s] == first[s + 1]) {
+      continue;
+    }
+    concurrent_shard_t* shard = &(ht->shards[s]);
+    concurrent_shard_write_lock(shard);
+    for (size_t j = first[s]; j < first[s + 1]; ++j) {
+      size_t i = order[j];
+      bool new_key = shard_table_insert_copy(shard->table, &keys[i], &values[i], NULL);
+      count += new_key;
+      if (inserted != NULL) {
+        inserted[i] = new_key;
+      }
+    }
+    concurrent_shard_write_unlock(shard);
+  }
+  concurrent_batch_scratch_free(scratch, stack_scratch);
+  return count;
+}
+
+/* Looks up the keys of group [begin, end) of order, into results and the found bitmap */
+static inline void concurrent_find_group(const concurrent_shard_t* shard, const int* keys, const size_t* order,
+                                         size_t begin, size_t end, int* results, unsigned char* found_bits) {
+  for (size_t j = begin; j < end; ++j) {
+    shard_table_entry_t* entry = shard_table_find(shard->table, &keys[order[j]]);
+    if (entry != NULL) {
+      results[j] = entry->value;
+      found_bits[j/8] |= (unsigned char)(1u << (j%8));
+    }
+    else {
+      found_bits[j/8] &= (unsigned char)~(1u << (j%8));
+    }
+  }
+}
+
+/*
+ * Looks up keys[i] for i in [0, n), storing the values of the keys that are
+ * found in values[i] and whether they were found in found[i] (optional).
+ * Returns the number of keys found.
+ */
+static inline size_t concurrent_find_many(concurrent_hashtable_t* ht, const int* keys, size_t n,
+                                          int* values, bool* found) {
+  size_t stack_scratch[CONCURRENT_HASHTABLE_STACK_SCRATCH];
+  size_t results_words = concurrent_words(n*sizeof(int));
+  size_t* scratch = concurrent_batch_scratch(ht, n, results_words + concurrent_words((n + 7)/8), stack_scratch);
+  size_t count = 0;
+  if (scratch == NULL) {
+    /* Out of memory for grouping the keys: one lookup per key instead */
+    for (size_t i = 0; i < n; ++i) {
+      bool key_found = concurrent_find(ht, &keys[i], &values[i]);
+      count += key_found;
+      if (found != NULL) {
+        found[i] = key_found;
+      }
+    }
+    return count;
+  }
+  size_t* shard_of = scratch;
+  size_t* order = scratch + n;
+  size_t* first = scratch + 2*n;
+  /* Results by position in order, kept until they are validated */
+  int* results = (int*)(first + ht->number_of_shards + 1);
+  unsigned char* found_bits = (unsigned char*)(first + ht->number_of_shards + 1 + results_words);
+  concurrent_group_by_shard(ht, keys, n, shard_of, order, first);
+  for (size_t s = 0; s < ht->number_of_shards; ++s) {
+    if (first[s] == first[s + 1]) {
+      continue;
+    }
+    concurrent_shard_t* shard = &(ht->shards[s]);
+    size_t shard_count = 0;
+    bool validated = false;
+    for (int retry = 0; retry < CONCURRENT_HASHTABLE_OPTIMISTIC_RETRIES && !validated; ++retry) {
+      unsigned sequence = concurrent_shard_read_begin(shard);
+      if (sequence & 1) {
+        continue;
+      }
+      concurrent_find_group(shard, keys, order, first[s], first[s + 1], results, found_bits);
+      validated = concurrent_shard_read_validate(shard, sequence);
+    }
+    if (!validated) {
+      pthread_mutex_lock(&(shard->mutex));
+      concurrent_find_group(shard, keys, order, first[s], first[s + 1], results, found_bits);
+      pthread_mutex_unlock(&(shard->mutex));
+    }
+    for (size_t j = first[s]; j < first[s + 1]; ++j) {
+      size_t i = order[j];
+      bool key_found = (found_bits[j/8] >> (j%8)) & 1;
+      if (key_found) {
+        values[i] = results[j];
+        ++shard_count;
+      }
+      if (found != NULL) {
+        found[i] = key_found;
+      }
+    }
+    count += shard_count;
+  }
+  concurrent_batch_scratch_free(scratch, stack_scratch);
+  return count;
+}
+
+#endif
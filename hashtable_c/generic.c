@@ -0,0 +1,90 @@
+#include <ctype.h>
+
+#include "hashtable.h"
+
+/*
+ * Counts the words read from stdin using a table instantiated for string keys
+ * and struct values, and checks an int -> int instantiation along the way.
+ */
+
+typedef struct {
+  int count;
+  int first_position;
+} word_stats_t;
+
+static inline void word_stats_init(word_stats_t* stats) {
+  stats->count = 0;
+  stats->first_position = -1;
+}
+
+static inline void word_stats_copy(const word_stats_t* src, word_stats_t* dst) {
+  *dst = *src;
+}
+
+static inline void word_stats_cleanup(word_stats_t* stats) {
+  (void)stats;
+}
+
+HASHTABLE_DEFINE(word_table, hashtable_string_t, word_stats_t, hashtable_string, word_stats)
+
+HASHTABLE_DEFINE(int_table, int, int, int, int)
+
+int main() {
+  int_table_t* squares = int_table_create(64);
+  for (int i = 0; i < 32; ++i) {
+    int square = i*i;
+    int_table_insert_copy(squares, &i, &square, NULL);
+  }
+  for (int i = 0; i < 32; i += 2) {
+    int_table_erase(squares, &i);
+  }
+  for (int i = 1; i < 32; i += 2) {
+    int_table_entry_t* entry = int_table_find(squares, &i);
+    if (entry == NULL || entry->value != i*i) {
+      printf("int_table: wrong entry for %d\n", i);
+      return 1;
+    }
+  }
+  printf("int_table: %lu entries\n", squares->size);
+  int_table_destroy(squares);
+
+  word_table_t* words = word_table_create(1 << 16);
+  char buffer[256];
+  int position = 0;
+  while (scanf("%255s", buffer) == 1) {
+    size_t length = 0;
+    for (size_t i = 0; buffer[i] != '\0'; ++i) {
+      if (isalnum((unsigned char)buffer[i])) {
+        buffer[length++] = tolower((unsigned char)buffer[i]);
+      }
+    }
+    if (length == 0) {
+      continue;
+    }
+    hashtable_string_t word;
+    hashtable_string_set(&word, buffer, length);
+    word_table_entry_t* entry;
+    if (word_table_insert_init(words, &word, &entry)) {
+      entry->value.first_position = position;
+    }
+    if (entry == NULL) {
+      printf("No more room in hash table\n");
+      hashtable_string_cleanup(&word);
+      break;
+    }
+    ++entry->value.count;
+    ++position;
+    hashtable_string_cleanup(&word);
+  }
+  printf("%d words, %lu distinct\n", position, words->size);
+  for (size_t i = 0; i < words->number_of_buckets; ++i) {
+    const word_table_bucket_t* bucket = &(words->buckets[i]);
+    if (bucket->assigned_index != SIZE_MAX && bucket->entry.value.count > 1) {
+      printf("%s: count=%d, first position=%d\n",
+          hashtable_string_cstr(&(bucket->entry.key)),
+          bucket->entry.value.count,
+          bucket->entry.value.first_position);
+    }
+  }
+  word_table_destroy(words);
+}
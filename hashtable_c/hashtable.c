@@ -1,9 +1,16 @@
+#define _POSIX_C_SOURCE 200112L
+
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 typedef int key_t;
 typedef int value_t;
 
@@ -121,7 +128,6 @@ bool insert_copy(hashtable_t* ht, const int* key, const int* value, hashtable_en
   size_t index = hashtable_index(ht, key);
   bool insert_successful = false;
   hashtable_bucket_t* bucket = find_bucket(ht, key, index);
-  printf("%lx\n", (size_t)bucket);
   if (bucket != NULL && bucket->assigned_index == SIZE_MAX) {
     bucket->assigned_index = index;
     int_copy(key, &(bucket->entry.key));
@@ -165,6 +171,136 @@ bool erase(hashtable_t* ht, const int* key) {
   return erased;
 }
 
+/*
+ * Creates a table with enough buckets to hold the n entries at a load factor
+ * of at most 3/4 and inserts them. Entries whose key is already in the table
+ * are skipped.
+ */
+hashtable_t* hashtable_build_from_array(const hashtable_entry_t* entries, size_t n) {
+  hashtable_t* ht = create_hashtable(n + n/3 + 1);
+  for (size_t i = 0; i < n; ++i) {
+    insert_copy(ht, &(entries[i].key), &(entries[i].value), NULL);
+  }
+  return ht;
+}
+
+/* Visits the entries in bucket order, i.e. sweeping the bucket array once */
+typedef struct {
+  hashtable_t* ht;
+  size_t index;
+} hashtable_iterator_t;
+
+hashtable_iterator_t hashtable_iterate(hashtable_t* ht) {
+  hashtable_iterator_t it = { ht, 0 };
+  return it;
+}
+
+hashtable_entry_t* hashtable_next(hashtable_iterator_t* it) {
+  while (it->index < it->ht->number_of_buckets) {
+    hashtable_bucket_t* bucket = &(it->ht->buckets[it->index++]);
+    if (bucket->assigned_index != SIZE_MAX) {
+      return &(bucket->entry);
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Snapshots are the raw image of a hashtable_t preceded by a header, so a
+ * mapped snapshot can be used as a table right away. The header has the size
+ * of a cache line, which keeps the table image aligned within the mapping.
+ */
+#define HASHTABLE_SNAPSHOT_MAGIC "HTSNAP\0\0"
+#define HASHTABLE_SNAPSHOT_VERSION 1u
+#define HASHTABLE_SNAPSHOT_BYTE_ORDER 0x01020304u
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t key_size;
+  uint32_t value_size;
+  uint32_t bucket_size;
+  uint32_t reserved;
+  uint64_t table_size;
+  char padding[24];
+} hashtable_snapshot_header_t;
+
+typedef struct {
+  void* mapping;
+  size_t length;
+  hashtable_t* ht;
+} hashtable_snapshot_t;
+
+inline size_t hashtable_image_size(size_t number_of_buckets) {
+  return sizeof(hashtable_t) + number_of_buckets*sizeof(hashtable_bucket_t);
+}
+
+bool hashtable_save_snapshot(const hashtable_t* ht, const char* path) {
+  hashtable_snapshot_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, HASHTABLE_SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = HASHTABLE_SNAPSHOT_VERSION;
+  header.byte_order = HASHTABLE_SNAPSHOT_BYTE_ORDER;
+  header.key_size = sizeof(key_t);
+  header.value_size = sizeof(value_t);
+  header.bucket_size = sizeof(hashtable_bucket_t);
+  header.table_size = hashtable_image_size(ht->number_of_buckets);
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) {
+    return false;
+  }
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 fwrite(ht, header.table_size, 1, file) == 1;
+  return fclose(file) == 0 && written;
+}
+
+/*
+ * Maps a snapshot privately: lookups read straight from the page cache and
+ * the pages that get modified (if any) are copied on write, so the file is
+ * never changed. Returns false if the file is not a snapshot of this version
+ * and layout.
+ */
+bool hashtable_open_snapshot(const char* path, hashtable_snapshot_t* snapshot) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  void* mapping = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(hashtable_snapshot_header_t) + sizeof(hashtable_t)) {
+    mapping = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  const hashtable_snapshot_header_t* header = mapping;
+  hashtable_t* ht = (hashtable_t*)(header + 1);
+  bool valid = memcmp(header->magic, HASHTABLE_SNAPSHOT_MAGIC, sizeof(header->magic)) == 0 &&
+               header->version == HASHTABLE_SNAPSHOT_VERSION &&
+               header->byte_order == HASHTABLE_SNAPSHOT_BYTE_ORDER &&
+               header->key_size == sizeof(key_t) &&
+               header->value_size == sizeof(value_t) &&
+               header->bucket_size == sizeof(hashtable_bucket_t) &&
+               header->table_size == (size_t)st.st_size - sizeof(*header) &&
+               header->table_size == hashtable_image_size(ht->number_of_buckets);
+  if (!valid) {
+    munmap(mapping, st.st_size);
+    return false;
+  }
+  snapshot->mapping = mapping;
+  snapshot->length = st.st_size;
+  snapshot->ht = ht;
+  return true;
+}
+
+void hashtable_close_snapshot(hashtable_snapshot_t* snapshot) {
+  munmap(snapshot->mapping, snapshot->length);
+  snapshot->mapping = NULL;
+  snapshot->ht = NULL;
+}
+
 void show_hashtable(const hashtable_t* ht) {
   printf("Number of buckets=%lu; size=%lu\n", ht->number_of_buckets, ht->size);
   for (size_t i = 0; i < ht->number_of_buckets; ++i) {
@@ -180,8 +316,19 @@ void show_hashtable(const hashtable_t* ht) {
   }
 }
 
-int main() {
-  hashtable_t* ht = create_hashtable(3);
+/*
+ * Usage: hashtable [snapshot]. If a snapshot is given, the table is mapped
+ * from it instead of starting empty.
+ */
+int main(int argc, char* argv[]) {
+  hashtable_snapshot_t snapshot = { NULL, 0, NULL };
+  hashtable_t* ht;
+  if (argc > 1 && hashtable_open_snapshot(argv[1], &snapshot)) {
+    ht = snapshot.ht;
+  }
+  else {
+    ht = create_hashtable(3);
+  }
   show_hashtable(ht);
   int cmd;
   scanf("%d", &cmd);
@@ -223,10 +370,33 @@ int main() {
         printf("Entry not found\n");
       }
     }
+    else if (cmd == 3) {
+      hashtable_iterator_t it = hashtable_iterate(ht);
+      hashtable_entry_t* entry;
+      while ((entry = hashtable_next(&it)) != NULL) {
+        printf("%d -> %d\n", entry->key, entry->value);
+      }
+    }
+    else if (cmd == 4) {
+      char path[256];
+      scanf("%255s", path);
+      if (hashtable_save_snapshot(ht, path)) {
+        printf("Snapshot saved to %s\n", path);
+      }
+      else {
+        printf("Could not save snapshot to %s\n", path);
+      }
+    }
     show_hashtable(ht);
     printf("----------------\n");
     scanf("%d", &cmd);
   }
+  if (snapshot.mapping != NULL) {
+    hashtable_close_snapshot(&snapshot);
+  }
+  else {
+    free(ht);
+  }
 }
 
 
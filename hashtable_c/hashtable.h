@@ -0,0 +1,253 @@
+#ifndef HASHTABLE_H
+#define HASHTABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Generic version of the linear probing table in hashtable.c.
+ *
+ * HASHTABLE_DEFINE(name, key_type, value_type, key_ops, value_ops) generates
+ * the types name_entry_t, name_bucket_t and name_t and the functions
+ * name_create, name_destroy, name_insert_init, name_insert_copy, name_find
+ * and name_erase, specialized for the given key and value types. The hooks
+ * are looked up by prefix, so they are called directly and can be inlined:
+ *
+ *   key_ops ## _hash, key_ops ## _eq, key_ops ## _copy, key_ops ## _cleanup
+ *   value_ops ## _init, value_ops ## _copy, value_ops ## _cleanup
+ *
+ * Hooks for int (int_*) and for hashtable_string_t (hashtable_string_*) are
+ * provided below. Entries are relocated with plain struct assignment when
+ * erasing, so key and value types must not point into themselves.
+ */
+
+static inline void int_cleanup(int* value) {
+  (void)value;
+}
+
+static inline void int_copy(const int* src, int* dst) {
+  *dst = *src;
+}
+
+static inline void int_init(int* value) {
+  *value = 0;
+}
+
+static inline size_t int_hash(const int* value) {
+  return (size_t)*value;
+}
+
+static inline bool int_eq(const int* l, const int* r) {
+  return *l == *r;
+}
+
+/*
+ * String with its hash computed once and, for short strings, the characters
+ * stored inline, so comparing keys during probing rarely leaves the bucket.
+ */
+
+#define HASHTABLE_STRING_INLINE_CAPACITY 23
+
+typedef struct {
+  size_t hash;
+  size_t length;
+  union {
+    char inline_chars[HASHTABLE_STRING_INLINE_CAPACITY + 1];
+    char* heap_chars;
+  } chars;
+} hashtable_string_t;
+
+static inline bool hashtable_string_is_inline(const hashtable_string_t* s) {
+  return s->length <= HASHTABLE_STRING_INLINE_CAPACITY;
+}
+
+static inline const char* hashtable_string_cstr(const hashtable_string_t* s) {
+  return hashtable_string_is_inline(s)? s->chars.inline_chars : s->chars.heap_chars;
+}
+
+/* FNV-1a */
+static inline size_t hashtable_string_compute_hash(const char* chars, size_t length) {
+  uint64_t hash = UINT64_C(14695981039346656037);
+  for (size_t i = 0; i < length; ++i) {
+    hash ^= (unsigned char)chars[i];
+    hash *= UINT64_C(1099511628211);
+  }
+  return (size_t)hash;
+}
+
+/* Initializes s with a copy of the first length characters of chars */
+static inline void hashtable_string_set(hashtable_string_t* s, const char* chars, size_t length) {
+  char* dst;
+  s->hash = hashtable_string_compute_hash(chars, length);
+  s->length = length;
+  if (hashtable_string_is_inline(s)) {
+    dst = s->chars.inline_chars;
+  }
+  else {
+    dst = s->chars.heap_chars = malloc(length + 1);
+  }
+  memcpy(dst, chars, length);
+  dst[length] = '\0';
+}
+
+static inline void hashtable_string_init(hashtable_string_t* s) {
+  hashtable_string_set(s, "", 0);
+}
+
+static inline void hashtable_string_cleanup(hashtable_string_t* s) {
+  if (!hashtable_string_is_inline(s)) {
+    free(s->chars.heap_chars);
+  }
+  s->length = 0;
+}
+
+static inline void hashtable_string_copy(const hashtable_string_t* src, hashtable_string_t* dst) {
+  if (hashtable_string_is_inline(src)) {
+    *dst = *src;
+  }
+  else {
+    hashtable_string_set(dst, src->chars.heap_chars, src->length);
+  }
+}
+
+static inline size_t hashtable_string_hash(const hashtable_string_t* s) {
+  return s->hash;
+}
+
+static inline bool hashtable_string_eq(const hashtable_string_t* l, const hashtable_string_t* r) {
+  return l->hash == r->hash && l->length == r->length &&
+    memcmp(hashtable_string_cstr(l), hashtable_string_cstr(r), l->length) == 0;
+}
+
+#define HASHTABLE_DEFINE(name, key_type, value_type, key_ops, value_ops) \
+\
+typedef struct { \
+  key_type key; \
+  value_type value; \
+} name ## _entry_t; \
+\
+typedef struct { \
+  size_t assigned_index; \
+  name ## _entry_t entry; \
+} name ## _bucket_t; \
+\
+typedef struct { \
+  size_t number_of_buckets; \
+  size_t size; \
+  name ## _bucket_t buckets[]; \
+} name ## _t; \
+\
+static inline name ## _t* name ## _create(size_t number_of_buckets) { \
+  name ## _t* ht = malloc(sizeof(name ## _t) + number_of_buckets*sizeof(name ## _bucket_t)); \
+  ht->number_of_buckets = number_of_buckets; \
+  ht->size = 0; \
+  for (size_t i = 0; i < ht->number_of_buckets; ++i) { \
+    ht->buckets[i].assigned_index = SIZE_MAX; \
+  } \
+  return ht; \
+} \
+\
+static inline void name ## _destroy(name ## _t* ht) { \
+  for (size_t i = 0; i < ht->number_of_buckets; ++i) { \
+    if (ht->buckets[i].assigned_index != SIZE_MAX) { \
+      key_ops ## _cleanup(&(ht->buckets[i].entry.key)); \
+      value_ops ## _cleanup(&(ht->buckets[i].entry.value)); \
+    } \
+  } \
+  free(ht); \
+} \
+\
+static inline size_t name ## _index(const name ## _t* ht, const key_type* key) { \
+  return key_ops ## _hash(key) % ht->number_of_buckets; \
+} \
+\
+/* First bucket from index on that is empty or holds the key; NULL if none */ \
+static inline name ## _bucket_t* name ## _find_bucket(name ## _t* ht, const key_type* key, size_t index) { \
+  size_t current = index; \
+  do { \
+    name ## _bucket_t* bucket = &(ht->buckets[current]); \
+    if (bucket->assigned_index == SIZE_MAX || key_ops ## _eq(&(bucket->entry.key), key)) { \
+      return bucket; \
+    } \
+    if (++current == ht->number_of_buckets) { \
+      current = 0; \
+    } \
+  } while (current != index); \
+  return NULL; \
+} \
+\
+static inline bool name ## _insert_init(name ## _t* ht, const key_type* key, name ## _entry_t** entry) { \
+  size_t index = name ## _index(ht, key); \
+  bool insert_successful = false; \
+  name ## _bucket_t* bucket = name ## _find_bucket(ht, key, index); \
+  if (bucket != NULL && bucket->assigned_index == SIZE_MAX) { \
+    bucket->assigned_index = index; \
+    key_ops ## _copy(key, &(bucket->entry.key)); \
+    value_ops ## _init(&(bucket->entry.value)); \
+    insert_successful = true; \
+    ++ht->size; \
+  } \
+  if (entry != NULL) { \
+    *entry = bucket == NULL? NULL : &(bucket->entry); \
+  } \
+  return insert_successful; \
+} \
+\
+static inline bool name ## _insert_copy(name ## _t* ht, const key_type* key, const value_type* value, name ## _entry_t** entry) { \
+  size_t index = name ## _index(ht, key); \
+  bool insert_successful = false; \
+  name ## _bucket_t* bucket = name ## _find_bucket(ht, key, index); \
+  if (bucket != NULL && bucket->assigned_index == SIZE_MAX) { \
+    bucket->assigned_index = index; \
+    key_ops ## _copy(key, &(bucket->entry.key)); \
+    value_ops ## _copy(value, &(bucket->entry.value)); \
+    insert_successful = true; \
+    ++ht->size; \
+  } \
+  if (entry != NULL) { \
+    *entry = bucket == NULL? NULL : &(bucket->entry); \
+  } \
+  return insert_successful; \
+} \
+\
+static inline name ## _entry_t* name ## _find(name ## _t* ht, const key_type* key) { \
+  name ## _bucket_t* bucket = name ## _find_bucket(ht, key, name ## _index(ht, key)); \
+  return bucket != NULL && bucket->assigned_index != SIZE_MAX? &(bucket->entry) : NULL; \
+} \
+\
+/* Backward shift deletion: no tombstones are left behind */ \
+static inline bool name ## _erase(name ## _t* ht, const key_type* key) { \
+  name ## _bucket_t* bucket = name ## _find_bucket(ht, key, name ## _index(ht, key)); \
+  if (bucket == NULL || bucket->assigned_index == SIZE_MAX) { \
+    return false; \
+  } \
+  key_ops ## _cleanup(&(bucket->entry.key)); \
+  value_ops ## _cleanup(&(bucket->entry.value)); \
+  --ht->size; \
+  size_t vacant = bucket - ht->buckets; \
+  size_t current = vacant; \
+  for (;;) { \
+    if (++current == ht->number_of_buckets) { \
+      current = 0; \
+    } \
+    size_t assigned_index = ht->buckets[current].assigned_index; \
+    if (assigned_index == SIZE_MAX || current == vacant) { \
+      break; \
+    } \
+    /* The entry moves back unless its home lies cyclically in (vacant, current] */ \
+    bool reachable = vacant <= current? \
+      (assigned_index <= vacant || assigned_index > current) : \
+      (assigned_index <= vacant && assigned_index > current); \
+    if (reachable) { \
+      ht->buckets[vacant] = ht->buckets[current]; \
+      vacant = current; \
+    } \
+  } \
+  ht->buckets[vacant].assigned_index = SIZE_MAX; \
+  return true; \
+}
+
+#endif
@@ -0,0 +1,331 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * Open addressing with a separate array of control bytes (Swiss table).
+ *
+ * Each slot has a control byte that is either EMPTY, DELETED or, when the
+ * slot is full, the 7 lowest bits of the hash of its key. Lookups scan the
+ * control bytes one group (16 slots) at a time and only touch the key array
+ * for slots whose 7-bit fragment matches, so most probes never leave the
+ * control array. Keys and values live in separate arrays, and groups are
+ * probed linearly starting at the group selected by the remaining bits of
+ * the hash.
+ */
+
+typedef int key_t;
+typedef int value_t;
+
+inline void int_cleanup(int* value) {
+  (void)value;
+}
+
+inline void int_copy(const int* src, int* dst) {
+  *dst = *src;
+}
+
+inline void int_init(int* value) {
+  *value = 0;
+}
+
+inline size_t int_hash(const int* value) {
+  return (size_t)*value;
+}
+
+inline bool int_eq(const int* l, const int* r) {
+  return *l == *r;
+}
+
+#define GROUP_WIDTH 16
+
+typedef int8_t ctrl_t;
+
+#define CTRL_EMPTY ((ctrl_t)-128)   /* 0b10000000 */
+#define CTRL_DELETED ((ctrl_t)-2)   /* 0b11111110 */
+
+/* Full slots have the most significant bit clear */
+inline bool ctrl_is_full(ctrl_t c) {
+  return c >= 0;
+}
+
+typedef struct {
+  key_t* key;
+  value_t* value;
+} hashtable_entry_t;
+
+typedef struct {
+  size_t number_of_groups;
+  size_t number_of_buckets;
+  size_t size;
+  ctrl_t* ctrl;
+  key_t* keys;
+  value_t* values;
+  /* ctrl, keys and values point into this block */
+  unsigned char storage[];
+} hashtable_t;
+
+hashtable_t* create_hashtable(size_t number_of_buckets) {
+  size_t number_of_groups = (number_of_buckets + GROUP_WIDTH - 1) / GROUP_WIDTH;
+  if (number_of_groups == 0) {
+    number_of_groups = 1;
+  }
+  number_of_buckets = number_of_groups*GROUP_WIDTH;
+  size_t keys_offset = number_of_buckets*sizeof(ctrl_t);
+  size_t values_offset = keys_offset + number_of_buckets*sizeof(key_t);
+  size_t storage_size = values_offset + number_of_buckets*sizeof(value_t);
+  hashtable_t* ht = malloc(sizeof(hashtable_t) + storage_size);
+  unsigned char* storage = ht->storage;
+  ht->number_of_groups = number_of_groups;
+  ht->number_of_buckets = number_of_buckets;
+  ht->size = 0;
+  ht->ctrl = (ctrl_t*)storage;
+  ht->keys = (key_t*)(storage + keys_offset);
+  ht->values = (value_t*)(storage + values_offset);
+  memset(ht->ctrl, CTRL_EMPTY, number_of_buckets);
+  return ht;
+}
+
+void destroy_hashtable(hashtable_t* ht) {
+  for (size_t i = 0; i < ht->number_of_buckets; ++i) {
+    if (ctrl_is_full(ht->ctrl[i])) {
+      int_cleanup(&(ht->keys[i]));
+      int_cleanup(&(ht->values[i]));
+    }
+  }
+  free(ht);
+}
+
+/*
+ * Bitmask with bit i set iff the i-th control byte of the group equals
+ * the given byte.
+ */
+inline uint32_t group_match(const ctrl_t* group, ctrl_t c) {
+#ifdef __SSE2__
+  __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+  return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(c), ctrl));
+#else
+  uint32_t mask = 0;
+  for (int i = 0; i < GROUP_WIDTH; ++i) {
+    mask |= (uint32_t)(group[i] == c) << i;
+  }
+  return mask;
+#endif
+}
+
+/* Bitmask of the slots of the group that are either empty or deleted */
+inline uint32_t group_match_available(const ctrl_t* group) {
+#ifdef __SSE2__
+  /* The most significant bit is only set for EMPTY and DELETED */
+  return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+  uint32_t mask = 0;
+  for (int i = 0; i < GROUP_WIDTH; ++i) {
+    mask |= (uint32_t)(group[i] < 0) << i;
+  }
+  return mask;
+#endif
+}
+
+/*
+ * The identity hash of int keys would leave the 7-bit fragment and the
+ * group index strongly correlated, so we mix it first.
+ */
+inline size_t mix_hash(size_t hash) {
+  uint64_t h = (uint64_t)hash*UINT64_C(0x9E3779B97F4A7C15);
+  return (size_t)(h ^ (h >> 32));
+}
+
+inline ctrl_t hash_fragment(size_t hash) {
+  return (ctrl_t)(hash & 0x7F);
+}
+
+inline size_t hashtable_group(const hashtable_t* ht, size_t hash) {
+  return (hash >> 7) % ht->number_of_groups;
+}
+
+/*
+ * Returns the index of the slot that holds the key or SIZE_MAX if the key is
+ * not in the table. If available is not NULL, it receives the first empty or
+ * deleted slot of the probe sequence (SIZE_MAX if there is none).
+ */
+size_t find_bucket(const hashtable_t* ht, const int* key, size_t hash, size_t* available) {
+  ctrl_t fragment = hash_fragment(hash);
+  size_t group = hashtable_group(ht, hash);
+  if (available != NULL) {
+    *available = SIZE_MAX;
+  }
+  for (size_t probe = 0; probe < ht->number_of_groups; ++probe) {
+    size_t base = group*GROUP_WIDTH;
+    const ctrl_t* ctrl = ht->ctrl + base;
+    uint32_t match = group_match(ctrl, fragment);
+    while (match != 0) {
+      size_t index = base + __builtin_ctz(match);
+      if (int_eq(&(ht->keys[index]), key)) {
+        return index;
+      }
+      match &= match - 1;
+    }
+    uint32_t free_slots = group_match_available(ctrl);
+    if (available != NULL && *available == SIZE_MAX && free_slots != 0) {
+      *available = base + __builtin_ctz(free_slots);
+    }
+    if (group_match(ctrl, CTRL_EMPTY) != 0) {
+      break;
+    }
+    if (++group == ht->number_of_groups) {
+      group = 0;
+    }
+  }
+  return SIZE_MAX;
+}
+
+inline hashtable_entry_t bucket_entry(hashtable_t* ht, size_t index) {
+  hashtable_entry_t entry = { NULL, NULL };
+  if (index != SIZE_MAX) {
+    entry.key = &(ht->keys[index]);
+    entry.value = &(ht->values[index]);
+  }
+  return entry;
+}
+
+/*
+ * Looks for the key, claiming an available slot for it if it is not there.
+ * Returns SIZE_MAX if the key is not in the table and there is no room.
+ */
+size_t claim_bucket(hashtable_t* ht, const int* key, bool* claimed) {
+  size_t hash = mix_hash(int_hash(key));
+  size_t available;
+  size_t index = find_bucket(ht, key, hash, &available);
+  *claimed = false;
+  if (index == SIZE_MAX && available != SIZE_MAX) {
+    index = available;
+    ht->ctrl[index] = hash_fragment(hash);
+    int_copy(key, &(ht->keys[index]));
+    *claimed = true;
+    ++ht->size;
+  }
+  return index;
+}
+
+bool insert_init(hashtable_t* ht, const int* key, hashtable_entry_t* entry) {
+  bool insert_successful;
+  size_t index = claim_bucket(ht, key, &insert_successful);
+  if (insert_successful) {
+    int_init(&(ht->values[index]));
+  }
+  if (entry != NULL) {
+    *entry = bucket_entry(ht, index);
+  }
+  return insert_successful;
+}
+
+bool insert_copy(hashtable_t* ht, const int* key, const int* value, hashtable_entry_t* entry) {
+  bool insert_successful;
+  size_t index = claim_bucket(ht, key, &insert_successful);
+  if (insert_successful) {
+    int_copy(value, &(ht->values[index]));
+  }
+  if (entry != NULL) {
+    *entry = bucket_entry(ht, index);
+  }
+  return insert_successful;
+}
+
+hashtable_entry_t find(hashtable_t* ht, const int* key) {
+  size_t hash = mix_hash(int_hash(key));
+  return bucket_entry(ht, find_bucket(ht, key, hash, NULL));
+}
+
+bool erase(hashtable_t* ht, const int* key) {
+  size_t hash = mix_hash(int_hash(key));
+  size_t index = find_bucket(ht, key, hash, NULL);
+  if (index == SIZE_MAX) {
+    return false;
+  }
+  int_cleanup(&(ht->keys[index]));
+  int_cleanup(&(ht->values[index]));
+  /*
+   * Probing never goes past a group with an empty slot, so if this group
+   * already has one no probe sequence depends on this slot being occupied
+   * and it can be marked as empty instead of leaving a tombstone.
+   */
+  const ctrl_t* group = ht->ctrl + index/GROUP_WIDTH*GROUP_WIDTH;
+  ht->ctrl[index] = group_match(group, CTRL_EMPTY) != 0? CTRL_EMPTY : CTRL_DELETED;
+  --ht->size;
+  return true;
+}
+
+void show_hashtable(const hashtable_t* ht) {
+  printf("Number of buckets=%lu; size=%lu\n", ht->number_of_buckets, ht->size);
+  for (size_t i = 0; i < ht->number_of_buckets; ++i) {
+    if (ht->ctrl[i] == CTRL_EMPTY) {
+      printf("%lu: empty\n", i);
+    }
+    else if (ht->ctrl[i] == CTRL_DELETED) {
+      printf("%lu: deleted\n", i);
+    }
+    else {
+      printf("%lu: Fragment=%02x, key=%d, value=%d\n", i,
+          (unsigned)ht->ctrl[i],
+          ht->keys[i],
+          ht->values[i]);
+    }
+  }
+}
+
+int main() {
+  hashtable_t* ht = create_hashtable(3);
+  show_hashtable(ht);
+  int cmd;
+  scanf("%d", &cmd);
+  while (cmd != -1) {
+    if (cmd == 0) {
+      int key, value;
+      hashtable_entry_t entry;
+      scanf("%d%d", &key, &value);
+      bool inserted = insert_copy(ht, &key, &value, &entry);
+      if (inserted) {
+        printf("New entry: %d -> %d\n", *entry.key, *entry.value);
+      }
+      else if (entry.key) {
+        printf("Existing entry: %d -> %d\n", *entry.key, *entry.value);
+      }
+      else {
+        printf("No more room in hash table\n");
+      }
+    }
+    else if (cmd == 1) {
+      int key;
+      scanf("%d", &key);
+      hashtable_entry_t entry = find(ht, &key);
+      if (entry.key == NULL) {
+        printf("Entry not found\n");
+      }
+      else {
+        printf("Found entry: %d -> %d\n", *entry.key, *entry.value);
+      }
+    }
+    else if (cmd == 2) {
+      int key;
+      scanf("%d", &key);
+      bool erased = erase(ht, &key);
+      if (erased) {
+        printf("Entry erased successfully\n");
+      }
+      else {
+        printf("Entry not found\n");
+      }
+    }
+    show_hashtable(ht);
+    printf("----------------\n");
+    scanf("%d", &cmd);
+  }
+  destroy_hashtable(ht);
+}
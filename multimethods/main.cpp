@@ -6,6 +6,12 @@
 #include <iostream>
 #include <utility>
 #include <functional>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <string>
 
 template<typename T, size_t size>
 struct tuple_n;
@@ -65,30 +71,118 @@ struct safe_cast<std::shared_ptr<U>,std::shared_ptr<T>> {
   }
 };
 
+// MAP looks the dynamic types of the arguments up in a std::map, which
+// compares std::type_index keys (by name on some ABIs) O(log n) times.
+// DENSE gives each class a small id when it first appears in addMethod()
+// and indexes a flat array of classes^arity handlers by the ids of the
+// arguments, in constant time; the array is rebuilt as classes are added.
+enum class Dispatch {
+  MAP,
+  DENSE
+};
+
 template<typename ReturnType, typename ...BaseClasses>
 class Multimethod {
   public:
     typedef std::function<ReturnType(BaseClasses...)> Handler;
     typedef tuple_of<sizeof...(BaseClasses), std::type_index> TypeKey;
 
+    explicit Multimethod(Dispatch dispatch = Dispatch::MAP) : _dispatch(dispatch) {
+    }
+
     template<typename ...ArgsIn>
     void addMethod(std::function<ReturnType(ArgsIn...)> handler) {
-      _vtable[type_indices<ArgsIn...>::get()] = [handler](BaseClasses... args_in) {
+      Handler& method = _vtable[type_indices<ArgsIn...>::get()] = [handler](BaseClasses... args_in) {
         return handler(safe_cast<ArgsIn,BaseClasses>::cast(args_in)...);
       };
+      if (_dispatch == Dispatch::DENSE) {
+        size_t ids[] = {addClass(typeid(ArgsIn))...};
+        _denseTable[denseIndex(ids)] = method;
+      }
     }
 
     ReturnType operator()(BaseClasses&& ...args) const {
+      if (_dispatch == Dispatch::DENSE) {
+        size_t ids[] = {classId(typeid(args))...};
+        for (size_t id : ids) {
+          if (id == NO_CLASS)
+            throw std::runtime_error("Method not found");
+        }
+        const Handler& handler = _denseTable[denseIndex(ids)];
+        if (!handler)
+          throw std::runtime_error("Method not found");
+        return handler(std::forward<BaseClasses>(args)...);
+      }
       auto key = TypeKey{type_index(args)...};
       auto entry = _vtable.find(key);
       if (entry == _vtable.end())
         throw std::runtime_error("Method not found");
-      auto handler = entry->second;
+      const Handler& handler = entry->second;
       return handler(std::forward<BaseClasses>(args)...);
     }
 
   private:
+    static const size_t ARITY = sizeof...(BaseClasses);
+    static const size_t NO_CLASS = static_cast<size_t>(-1);
+
+    size_t classId(const std::type_info& type) const {
+      auto byAddress = _classIdsByAddress.find(&type);
+      if (byAddress != _classIdsByAddress.end())
+        return byAddress->second;
+      // A type can have several type_info objects, e.g. across shared libraries
+      auto byType = _classIds.find(std::type_index(type));
+      if (byType == _classIds.end())
+        return NO_CLASS;
+      return byType->second;
+    }
+
+    size_t addClass(const std::type_info& type) {
+      size_t id = classId(type);
+      if (id == NO_CLASS) {
+        id = _classIds.size();
+        _classIds[std::type_index(type)] = id;
+        growDenseTable(id + 1);
+      }
+      _classIdsByAddress[&type] = id;
+      return id;
+    }
+
+    // The ids of the arguments are the digits of the index, in base classes
+    size_t denseIndex(const size_t* ids) const {
+      size_t index = 0;
+      for (size_t i = 0; i < ARITY; ++i)
+        index = index * _denseClasses + ids[i];
+      return index;
+    }
+
+    void growDenseTable(size_t classes) {
+      size_t size = 1;
+      for (size_t i = 0; i < ARITY; ++i)
+        size *= classes;
+      std::vector<Handler> table(size);
+      for (size_t index = 0; index < _denseTable.size(); ++index) {
+        if (!_denseTable[index])
+          continue;
+        size_t newIndex = 0;
+        size_t rest = index;
+        size_t scale = 1;
+        for (size_t i = 0; i < ARITY; ++i) {
+          newIndex += rest % _denseClasses * scale;
+          rest /= _denseClasses;
+          scale *= classes;
+        }
+        table[newIndex] = std::move(_denseTable[index]);
+      }
+      _denseTable = std::move(table);
+      _denseClasses = classes;
+    }
+
+    Dispatch _dispatch;
     std::map<TypeKey, Handler> _vtable;
+    std::unordered_map<std::type_index, size_t> _classIds;
+    std::unordered_map<const std::type_info*, size_t> _classIdsByAddress;
+    size_t _denseClasses = 0;
+    std::vector<Handler> _denseTable;
 };
 
 struct Thing {
@@ -105,7 +199,7 @@ struct Spaceship : public Thing {
 // declare_method(void, collisionOutcome, const Thing&, const Thing&)
 
 Multimethod<void,const Thing&, const Thing&>& get_collisionOutcomeMultimethod() {
-  static Multimethod<void,const Thing&,const Thing&> multimethod;
+  static Multimethod<void,const Thing&,const Thing&> multimethod(Dispatch::DENSE);
   return multimethod;
 }
 
@@ -147,7 +241,84 @@ void print(const std::shared_ptr<Thing>& thing) {
   std::cout << "Thing" << std::endl;
 }
 
-int main() {
+// Collision handling of a simulation, for every pair of objects each frame,
+// with each dispatch; run with "benchmark" as argument
+
+typedef Multimethod<void,const Thing&,const Thing&> Collision;
+
+template<int N>
+struct Debris : public Thing {
+};
+
+template<typename ...Classes>
+struct CollisionBenchmark {
+  static const size_t THINGS = 1000;
+  static const size_t FRAMES = 20;
+
+  template<typename Thing1, typename Thing2>
+  static void addCollision(Collision& collision, size_t& collisions) {
+    std::function<void(const Thing1&, const Thing2&)> fn = [&collisions](const Thing1&, const Thing2&) {
+      ++collisions;
+    };
+    collision.addMethod(fn);
+  }
+
+  template<typename Thing1>
+  static void addCollisions(Collision& collision, size_t& collisions) {
+    int expand[] = {(addCollision<Thing1,Classes>(collision, collisions), 0)...};
+    (void)expand;
+  }
+
+  static std::vector<std::unique_ptr<Thing>> makeThings() {
+    std::function<Thing*()> factories[] = {[]() -> Thing* { return new Classes(); }...};
+    std::mt19937 random(42);
+    std::uniform_int_distribution<size_t> pick(0, sizeof...(Classes) - 1);
+    std::vector<std::unique_ptr<Thing>> things;
+    for (size_t i = 0; i < THINGS; ++i)
+      things.emplace_back(factories[pick(random)]());
+    return things;
+  }
+
+  static void run(Dispatch dispatch, const char* name, const std::vector<std::unique_ptr<Thing>>& things) {
+    Collision collision(dispatch);
+    size_t collisions = 0;
+    int expand[] = {(addCollisions<Classes>(collision, collisions), 0)...};
+    (void)expand;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t frame = 0; frame < FRAMES; ++frame) {
+      for (size_t i = 0; i < things.size(); ++i) {
+        for (size_t j = i + 1; j < things.size(); ++j)
+          collision(*things[i], *things[j]);
+      }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << name << "," << sizeof...(Classes) << "," << collisions / elapsed.count() << std::endl;
+  }
+
+  static void run() {
+    auto things = makeThings();
+    run(Dispatch::MAP, "map", things);
+    run(Dispatch::DENSE, "dense", things);
+  }
+};
+
+void benchmark() {
+  std::cout << "dispatch,classes,pairs_per_s" << std::endl;
+  CollisionBenchmark<Asteroid, Spaceship>::run();
+  CollisionBenchmark<Asteroid, Spaceship, Debris<0>, Debris<1>, Debris<2>, Debris<3>, Debris<4>,
+                     Debris<5>>::run();
+  CollisionBenchmark<Asteroid, Spaceship, Debris<0>, Debris<1>, Debris<2>, Debris<3>, Debris<4>,
+                     Debris<5>, Debris<6>, Debris<7>, Debris<8>, Debris<9>, Debris<10>, Debris<11>,
+                     Debris<12>, Debris<13>, Debris<14>, Debris<15>, Debris<16>, Debris<17>, Debris<18>,
+                     Debris<19>, Debris<20>, Debris<21>, Debris<22>, Debris<23>, Debris<24>, Debris<25>,
+                     Debris<26>, Debris<27>, Debris<28>, Debris<29>>::run();
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && std::string(argv[1]) == "benchmark") {
+    benchmark();
+    return 0;
+  }
   collisionOutcome(Asteroid(), Spaceship());
   collisionOutcome(Asteroid(), Asteroid());
   auto asteroid = std::make_shared<Asteroid>();
@@ -0,0 +1,56 @@
+#!/bin/sh
+# Generates the list of plugins of static_registry.hpp from the
+# REGISTER_PLUGIN(plugin_name, PluginClass) lines of the given sources, each
+# class being looked up in the headers next to its source. Meant to run as a
+# build step whenever a source changes, e.g.
+#     ./gen_static_plugins.sh static_plugins.hpp *.cpp
+# The output is only replaced once it has been generated completely.
+set -e
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 output.hpp source.cpp..." >&2
+    exit 1
+fi
+output=$1
+shift
+output_directory=$(dirname "$output")
+temporary=$(mktemp "$output.XXXXXX")
+trap 'rm -f "$temporary"' EXIT
+
+# One "plugin_name PluginClass header" line per plugin, sorted by name
+registrations=""
+for source in "$@"; do
+    source_directory=$(dirname "$source")
+    for registration in $(sed -n 's/^REGISTER_PLUGIN( *\([A-Za-z0-9_]*\) *, *\([A-Za-z0-9_:]*\) *).*/\1:\2/p' "$source"); do
+        plugin_name=${registration%%:*}
+        plugin_class=${registration#*:}
+        header=$(grep -l "class $plugin_class\b" "$source_directory"/*.hpp 2>/dev/null | head -n 1)
+        if [ -z "$header" ]; then
+            echo "$source: no header next to it declares $plugin_class" >&2
+            exit 1
+        fi
+        header=$(realpath --relative-to="$output_directory" "$header")
+        registrations="$registrations$plugin_name $plugin_class $header
+"
+    done
+done
+registrations=$(printf '%s' "$registrations" | sort)
+
+{
+    echo "#pragma once"
+    echo
+    echo "// Generated by gen_static_plugins.sh, do not edit"
+    echo
+    printf '%s\n' "$registrations" | while read -r plugin_name plugin_class header; do
+        [ -n "$header" ] && echo "#include \"$header\""
+    done
+    echo
+    echo "#define STATIC_PLUGINS(PLUGIN) \\"
+    printf '%s\n' "$registrations" | while read -r plugin_name plugin_class header; do
+        [ -n "$header" ] && echo "    PLUGIN($plugin_name, $plugin_class) \\"
+    done
+    echo
+} > "$temporary"
+chmod 644 "$temporary"
+mv "$temporary" "$output"
+trap - EXIT
@@ -31,3 +31,21 @@ PluginPtr create_plugin(const std::string& plugin_name) {
     }
     return (it->second)();
 }
+
+int get_parameter_handle(const PluginPtr& plugin, const std::string& parameter) {
+    int handle = plugin->get_batch_functions().find_parameter(parameter.c_str());
+    if (handle < 0) {
+        throw std::invalid_argument(parameter + ": this plugin does not admit this parameter");
+    }
+    return handle;
+}
+
+void set_parameter(const PluginPtr& plugin, int handle, double value) {
+    if (plugin->get_batch_functions().set_parameter(plugin.get(), handle, value) != 0) {
+        throw std::invalid_argument(std::to_string(handle) + ": invalid parameter handle");
+    }
+}
+
+void process_batch(const PluginPtr& plugin, const PluginItem* items, size_t count, PluginOutput* outputs) {
+    plugin->get_batch_functions().process_batch(plugin.get(), items, count, outputs);
+}
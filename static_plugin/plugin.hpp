@@ -1,13 +1,14 @@
 #pragma once
 
 #include <any>
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
-#define REGISTER_PLUGIN(plugin_name,PluginClass) bool plugin_name ## _registered = add_plugin(#plugin_name,PluginClass::create)
+#define REGISTER_PLUGIN(plugin_name,PluginClass) bool plugin_name ## _registered = add_plugin(#plugin_name,[]() { return PluginClass::create(); })
 
 class Plugin;
 typedef std::shared_ptr<Plugin> PluginPtr;
@@ -23,22 +24,89 @@ std::vector<std::string> get_plugin_list();
 
 PluginPtr create_plugin(const std::string& plugin_name);
 
+// Batch interface, next to the virtual one: plain C functions taking the
+// plugin as their first argument. process_batch handles a whole batch in one
+// call, and parameters are set through integer handles resolved once from
+// their name by find_parameter (-1 if unknown) instead of a string and a
+// std::any. set_parameter returns 0, or -1 for an invalid handle.
+struct PluginItem {
+    double value;
+};
+
+struct PluginOutput {
+    double value;
+};
+
+extern "C" {
+typedef int (*PluginParameterFinder)(const char* parameter);
+typedef int (*PluginParameterSetter)(Plugin* plugin, int handle, double value);
+typedef void (*PluginBatchFunction)(Plugin* plugin, const PluginItem* items, size_t count, PluginOutput* outputs);
+}
+
+struct PluginBatchFunctions {
+    PluginParameterFinder find_parameter;
+    PluginParameterSetter set_parameter;
+    PluginBatchFunction process_batch;
+};
+
+// Wrappers of the batch functions of a plugin, throwing std::invalid_argument
+// for unknown parameters and invalid handles
+int get_parameter_handle(const PluginPtr& plugin, const std::string& parameter);
+
+void set_parameter(const PluginPtr& plugin, int handle, double value);
+
+void process_batch(const PluginPtr& plugin, const PluginItem* items, size_t count, PluginOutput* outputs);
+
 class Plugin {
     public:
     
         virtual void set_parameter(const std::string& parameter, std::any value) = 0;
     
         virtual std::string get_message() const = 0;
+        
+        virtual const PluginBatchFunctions& get_batch_functions() const = 0;
     
         virtual ~Plugin() = default;
 };
 
+// Derived provides the batch functions as
+//     static int find_parameter(const char* parameter);
+//     int set_parameter(int handle, double value);
+//     void process_batch(const PluginItem* items, size_t count, PluginOutput* outputs);
+// which are called without virtual dispatch
 template <class Derived>
 class PluginCRTP : public Plugin {
     public:
         static PluginPtr create() {
             return std::make_shared<Derived>();
         }
+        
+        // Allocates the plugin and its reference count together from
+        // allocator instead of operator new, e.g. with a
+        // std::pmr::polymorphic_allocator over an arena
+        template <class Allocator>
+        static PluginPtr create(const Allocator& allocator) {
+            return std::allocate_shared<Derived>(allocator);
+        }
+        
+        const PluginBatchFunctions& get_batch_functions() const override {
+            static const PluginBatchFunctions functions = {
+                &Derived::find_parameter,
+                &set_parameter_of,
+                &process_batch_of
+            };
+            return functions;
+        }
+    
+    private:
+    
+        static int set_parameter_of(Plugin* plugin, int handle, double value) {
+            return static_cast<Derived*>(plugin)->set_parameter(handle, value);
+        }
+        
+        static void process_batch_of(Plugin* plugin, const PluginItem* items, size_t count, PluginOutput* outputs) {
+            static_cast<Derived*>(plugin)->process_batch(items, count, outputs);
+        }
 };
 
 
@@ -1,9 +1,15 @@
 #include "real_plugin.hpp"
+#include <cstring>
+#include <stdexcept>
 
 void RealPlugin::set_parameter(const std::string& parameter, std::any value) {
+    int handle = find_parameter(parameter.c_str());
     if (parameter == "greeting") {
         m_greeting = std::any_cast<std::string>(value);
     }
+    else if (handle >= 0) {
+        set_parameter(handle, std::any_cast<double>(value));
+    }
     else {
         throw std::invalid_argument(parameter + ": this plugin does admit this parameter");
     }
@@ -13,4 +19,22 @@ std::string RealPlugin::get_message() const {
     return m_greeting + " world!";
 }
 
+int RealPlugin::find_parameter(const char* parameter) {
+    if (std::strcmp(parameter, "scale") == 0) {
+        return SCALE;
+    }
+    if (std::strcmp(parameter, "offset") == 0) {
+        return OFFSET;
+    }
+    return -1;
+}
+
+int RealPlugin::set_parameter(int handle, double value) {
+    if (handle < 0 || handle >= PARAMETER_COUNT) {
+        return -1;
+    }
+    m_parameters[handle] = value;
+    return 0;
+}
+
 REGISTER_PLUGIN(real_plugin, RealPlugin);
@@ -7,13 +7,29 @@ class RealPlugin : public PluginCRTP<RealPlugin> {
         RealPlugin() : m_greeting("Hello") {
         }
     
+        // Parameter handles of the batch functions
+        enum Parameter { SCALE, OFFSET, PARAMETER_COUNT };
+    
         void set_parameter(const std::string& parameter, std::any value) override;
         
         virtual std::string get_message() const override;
+        
+        static int find_parameter(const char* parameter);
+        
+        int set_parameter(int handle, double value);
+        
+        void process_batch(const PluginItem* items, size_t count, PluginOutput* outputs) const {
+            double scale = m_parameters[SCALE];
+            double offset = m_parameters[OFFSET];
+            for (size_t i = 0; i < count; ++i) {
+                outputs[i].value = items[i].value * scale + offset;
+            }
+        }
     
     private:
     
         std::string m_greeting;
+        double m_parameters[PARAMETER_COUNT] = { 1.0, 0.0 };
 };
 
 
@@ -0,0 +1,9 @@
+#pragma once
+
+// Generated by gen_static_plugins.sh, do not edit
+
+#include "real_plugin.hpp"
+
+#define STATIC_PLUGINS(PLUGIN) \
+    PLUGIN(real_plugin, RealPlugin) \
+
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "plugin.hpp"
+#include "static_plugins.hpp"
+
+// Alternative to the REGISTER_PLUGIN registry, fixed at build time: the
+// plugins listed in static_plugins.hpp (generated by gen_static_plugins.sh
+// from the REGISTER_PLUGIN lines) form a constexpr table sorted by name.
+// Nothing runs at static initialization, and a lookup is a binary search
+// that allocates nothing.
+
+typedef PluginPtr (*StaticPluginFactory)();
+typedef PluginPtr (*StaticPluginResourceFactory)(std::pmr::memory_resource* resource);
+
+struct StaticPluginEntry {
+    std::string_view plugin_name;
+    StaticPluginFactory factory_function;
+    StaticPluginResourceFactory resource_factory_function;
+};
+
+namespace detail {
+
+template <class PluginClass>
+PluginPtr create_static_plugin() {
+    return PluginClass::create();
+}
+
+template <class PluginClass>
+PluginPtr create_static_plugin(std::pmr::memory_resource* resource) {
+    return PluginClass::create(std::pmr::polymorphic_allocator<PluginClass>(resource));
+}
+
+template <size_t N>
+constexpr std::array<StaticPluginEntry, N> sort_static_plugins(std::array<StaticPluginEntry, N> entries) {
+    for (size_t i = 1; i < N; ++i) {
+        for (size_t j = i; j > 0 && entries[j].plugin_name < entries[j - 1].plugin_name; --j) {
+            auto entry = entries[j];
+            entries[j] = entries[j - 1];
+            entries[j - 1] = entry;
+        }
+    }
+    return entries;
+}
+
+template <size_t N>
+constexpr bool static_plugin_names_are_unique(const std::array<StaticPluginEntry, N>& entries) {
+    for (size_t i = 1; i < N; ++i) {
+        if (entries[i].plugin_name == entries[i - 1].plugin_name) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+#define STATIC_PLUGIN_ENTRY(plugin_name, PluginClass) \
+    StaticPluginEntry{#plugin_name, &detail::create_static_plugin<PluginClass>, \
+                      &detail::create_static_plugin<PluginClass>},
+
+inline constexpr auto STATIC_PLUGIN_TABLE = detail::sort_static_plugins(std::array{
+    STATIC_PLUGINS(STATIC_PLUGIN_ENTRY)
+});
+
+#undef STATIC_PLUGIN_ENTRY
+
+static_assert(detail::static_plugin_names_are_unique(STATIC_PLUGIN_TABLE), "duplicated static plugin name");
+
+// NULL if there is no such plugin
+constexpr const StaticPluginEntry* find_static_plugin(std::string_view plugin_name) {
+    size_t begin = 0;
+    size_t end = STATIC_PLUGIN_TABLE.size();
+    while (begin < end) {
+        size_t middle = begin + (end - begin) / 2;
+        if (STATIC_PLUGIN_TABLE[middle].plugin_name < plugin_name) {
+            begin = middle + 1;
+        }
+        else {
+            end = middle;
+        }
+    }
+    if (begin != STATIC_PLUGIN_TABLE.size() && STATIC_PLUGIN_TABLE[begin].plugin_name == plugin_name) {
+        return &STATIC_PLUGIN_TABLE[begin];
+    }
+    return NULL;
+}
+
+inline const StaticPluginEntry& get_static_plugin(std::string_view plugin_name) {
+    auto entry = find_static_plugin(plugin_name);
+    if (entry == NULL) {
+        throw std::runtime_error(std::string(plugin_name) + ": non-existent plugin");
+    }
+    return *entry;
+}
+
+inline PluginPtr create_static_plugin(std::string_view plugin_name) {
+    return get_static_plugin(plugin_name).factory_function();
+}
+
+// The plugin and its reference count are allocated from resource
+inline PluginPtr create_static_plugin(std::string_view plugin_name, std::pmr::memory_resource* resource) {
+    return get_static_plugin(plugin_name).resource_factory_function(resource);
+}
@@ -1,7 +1,15 @@
+#include <cstddef>
 #include <iostream>
+#include <memory_resource>
 #include "plugin.hpp"
+#include "static_registry.hpp"
 using namespace std;
 
+// The compile-time registry is resolved while compiling
+static_assert(find_static_plugin("real_plugin") != NULL, "real_plugin missing from the static registry");
+static_assert(find_static_plugin("real_plugin")->plugin_name == "real_plugin", "static registry lookup");
+static_assert(find_static_plugin("no_such_plugin") == NULL, "static registry found an unknown plugin");
+
 int main() {
     auto plugin_list = get_plugin_list();
     if (plugin_list.empty()) {
@@ -18,4 +26,20 @@ int main() {
     plugin->set_parameter("greeting", std::string("Bye"));
     
     cout << plugin->get_message() << endl;
+    
+    int scale = get_parameter_handle(plugin, "scale");
+    set_parameter(plugin, scale, 2.0);
+    PluginItem items[] = { {1.0}, {2.0}, {3.0} };
+    PluginOutput outputs[3];
+    process_batch(plugin, items, 3, outputs);
+    cout << "batch: " << outputs[0].value << " " << outputs[1].value << " " << outputs[2].value << endl;
+    
+    // A plugin of the compile-time registry, placed with its reference
+    // count in a buffer of the stack
+    std::byte buffer[1024];
+    std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+    auto static_plugin = create_static_plugin("real_plugin", &arena);
+    auto address = reinterpret_cast<std::byte*>(static_plugin.get());
+    bool in_arena = address >= buffer && address < buffer + sizeof(buffer);
+    cout << "static: " << static_plugin->get_message() << (in_arena ? " (in arena)" : " (NOT in arena)") << endl;
 }